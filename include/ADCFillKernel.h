@@ -0,0 +1,34 @@
+#ifndef ADC_FILL_KERNEL_H
+#define ADC_FILL_KERNEL_H
+
+#include <cstdint>
+#include <string>
+
+/* Fill kernel for one event of a board
+
+   For every channel c the ADC window adcMin <= adc[c] <= adcMax is applied, the bin is
+   looked up in the ADC->bin table and the count matrix (channel-major, stride entries per
+   channel) is incremented:
+
+       counts[c*stride + (in window ? lut[adc[c]] : discardBin)] += 1
+
+   The AVX2 and AVX-512 versions handle 8 and 16 channels per step.  The best version the
+   CPU supports is picked at the first call; all versions give identical counts.
+ */
+
+enum class ADCFillKernel
+{
+    Scalar,
+    AVX2,
+    AVX512,
+};
+
+void fillADCBoard(const unsigned short* adc, const int nChannels, const uint32_t* lut, uint32_t* counts, const int stride, const uint32_t discardBin, const unsigned short adcMin, const unsigned short adcMax);
+
+//Kernel used by fillADCBoard, can be forced (e.g. for benchmarks) as long as the CPU supports it
+ADCFillKernel getADCFillKernel();
+bool setADCFillKernel(const ADCFillKernel kernel);
+bool isADCFillKernelSupported(const ADCFillKernel kernel);
+std::string getADCFillKernelName(const ADCFillKernel kernel);
+
+#endif
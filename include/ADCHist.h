@@ -0,0 +1,108 @@
+#ifndef ADC_HIST_H
+#define ADC_HIST_H
+
+#include "NTRException.h"
+#include "ADCFillKernel.h"
+
+#include "TH1D.h"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <algorithm>
+
+/* Dense integer histograms of the ADC spectrum of every channel of one board
+
+   The ADC code of a hit is mapped to its bin through a precomputed table (uniform or
+   variable bin edges, same bin assignment as TH1D::Fill) and the counts of all channels
+   live in one contiguous array, channel after channel.  The histograms are only turned
+   into TH1D when they are needed for fitting.
+
+   ADCHist board("FERS_Board3", 64, 1000, 0, 2000, 21, 4999);
+   while(tr.getNextEvent()) board.fillBoard(tr.getVec<unsigned short>("FERS_Board3_energyHG"));
+   std::shared_ptr<TH1D> h = board.toTH1D(5);
+ */
+
+class ADCHist
+{
+public:
+    //Number of possible ADC codes, the size of the bin lookup table
+    static constexpr int nADCCodes = 65536;
+
+    ADCHist();
+    //Uniform binning, as TH1D(name, title, nBins, xMin, xMax), hits outside [adcMin, adcMax] are not counted
+    ADCHist(const std::string& name, const int nChannels, const int nBins, const double xMin, const double xMax, const unsigned short adcMin = 0, const unsigned short adcMax = nADCCodes - 1);
+    //Variable binning, as TH1D(name, title, binEdges.size() - 1, binEdges.data())
+    ADCHist(const std::string& name, const int nChannels, const std::vector<double>& binEdges, const unsigned short adcMin = 0, const unsigned short adcMax = nADCCodes - 1);
+
+    const std::string& getName() const { return name_; }
+    int getNChannels() const { return nChannels_; }
+    int getNBins() const { return nBins_; }
+    //Distance between two channels in the count array (bins + underflow, overflow and discard slot)
+    int getStride() const { return stride_; }
+    //Slot after the overflow bin which takes the hits outside the ADC window
+    uint32_t getDiscardBin() const { return discardBin_; }
+    unsigned short getADCMin() const { return adcMin_; }
+    unsigned short getADCMax() const { return adcMax_; }
+    const std::vector<double>& getBinEdges() const { return binEdges_; }
+
+    //Bin (0 = underflow, nBins + 1 = overflow) of each ADC code
+    const uint32_t* getBinTable() const { return lut_.data(); }
+
+    uint32_t* getCounts() { return counts_.data(); }
+    const uint32_t* getCounts() const { return counts_.data(); }
+    uint32_t getBinContent(const int channel, const int bin) const { return counts_[channel*stride_ + bin]; }
+
+    //Change the number of channels, e.g. once the first event is read; clears the counts
+    void setNChannels(const int nChannels);
+
+    inline void fill(const int channel, const unsigned short adc)
+    {
+        //out of window hits go to the discard slot, this keeps the loop free of branches
+        const uint32_t bin = (adc >= adcMin_ && adc <= adcMax_) ? lut_[adc] : discardBin_;
+        ++counts_[channel*stride_ + bin];
+    }
+
+    //Fill a real value rather than an ADC code (e.g. a time), binned as TAxis::FindBin without
+    //the ADC window; NaN goes to the discard slot
+    inline void fillValue(const int channel, const double x)
+    {
+        ++counts_[channel*stride_ + findBin(x)];
+    }
+
+    //Bin of a value (0 = underflow, nBins + 1 = overflow), the discard slot for NaN
+    uint32_t findBin(const double x) const;
+
+    inline void fillBoard(const std::vector<unsigned short>& adc)
+    {
+        //window, bin lookup and increment of all channels at once (SIMD where available)
+        const int nChannels = std::min(static_cast<int>(adc.size()), nChannels_);
+        fillADCBoard(adc.data(), nChannels, lut_.data(), counts_.data(), stride_, discardBin_, adcMin_, adcMax_);
+    }
+
+    void add(const ADCHist& other);
+    void reset();
+
+    //Number of counted hits of a channel, including under- and overflow
+    uint64_t getEntries(const int channel) const;
+
+    std::string getChannelName(const int channel) const { return name_ + "_Channel" + std::to_string(channel); }
+
+    //Convert one channel, by default named <name>_Channel<channel>
+    std::shared_ptr<TH1D> toTH1D(const int channel, const std::string& histName = "") const;
+
+private:
+    std::string name_;
+    int nChannels_, nBins_, stride_;
+    uint32_t discardBin_;
+    double xMin_, xMax_;
+    unsigned short adcMin_, adcMax_;
+    std::vector<double> binEdges_;
+    std::vector<uint32_t> lut_;
+    std::vector<uint32_t> counts_;
+
+    void init(const int nChannels);
+};
+
+#endif
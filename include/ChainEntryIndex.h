@@ -0,0 +1,92 @@
+#ifndef CHAIN_ENTRY_INDEX_H
+#define CHAIN_ENTRY_INDEX_H
+
+#include "NTRException.h"
+
+#include "TTree.h"
+
+#include <vector>
+#include <string>
+#include <utility>
+
+/* Per-file entry counts of a TChain which are filled in lazily
+
+   TChain::GetEntries() opens every file of the chain just to count the entries.  This
+   index only knows the count of a file once the file was read (or explicitly resolved)
+   and estimates the others from the average of the known files until then.  The index
+   can be saved next to the file list so the next job starts with exact counts.
+
+   ChainEntryIndex index(chain);
+   index.load("runList.txt.entries");
+   bool exact;
+   Long64_t n = index.getNEntries(exact);
+ */
+
+class ChainEntryIndex
+{
+public:
+    struct FileEntries
+    {
+        std::string fileName;
+        std::string treeName;
+        Long64_t nEntries;
+        Long64_t fileSize;
+        bool exact;
+    };
+
+    ChainEntryIndex();
+    explicit ChainEntryIndex(TTree * tree);
+
+    void setTree(TTree * tree);
+
+    int getNFiles() const { return files_.size(); }
+    const FileEntries& getFile(const int iFile) const { return files_.at(iFile); }
+
+    //Entry count of one file or the whole chain, "exact" is false if an estimate was used
+    Long64_t getNEntries(const int iFile, bool& exact) const;
+    Long64_t getNEntries(bool& exact) const;
+    bool isExact() const;
+    int getNExactFiles() const;
+
+    //First entry of file iFile in the chain numbering
+    Long64_t getFirstEntry(const int iFile, bool& exact) const;
+
+    //Split the chain in nRanges [first, last) entry ranges of similar size
+    std::vector<std::pair<Long64_t, Long64_t>> partition(const int nRanges, bool& exact) const;
+
+    //Record an exact count, e.g. once the file was loaded by the chain
+    void setNEntries(const int iFile, const Long64_t nEntries);
+
+    //Pick up any counts the TChain already knows about without opening files
+    void update();
+
+    //Open file iFile (or all unknown files) to get the exact count
+    Long64_t resolve(const int iFile);
+    void resolveAll();
+
+    void load(const std::string& indexName);
+    void save(const std::string& indexName) const;
+
+    static std::string defaultIndexName(const std::string& fileListName) { return fileListName + ".entries"; }
+
+private:
+    TTree *tree_;
+    std::vector<FileEntries> files_;
+
+    //running sum over the exact files, so that an estimate costs no pass over the files
+    int nExactFiles_;
+    Long64_t nExactEntries_;
+
+    //first entry of every file and of the end of the chain, and the first file with an estimated
+    //count; rebuilt once after a count changed rather than summed up for every file
+    mutable std::vector<Long64_t> firstEntries_;
+    mutable int firstEstimated_;
+    mutable bool firstEntriesValid_;
+
+    Long64_t estimatedEntries() const;
+    void updateFirstEntries() const;
+
+    static Long64_t getFileSize(const std::string& fileName);
+};
+
+#endif
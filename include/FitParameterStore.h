@@ -0,0 +1,58 @@
+#ifndef FIT_PARAMETER_STORE_H
+#define FIT_PARAMETER_STORE_H
+
+#include "NTRException.h"
+
+#include <map>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+/* Per-channel fit results kept between jobs
+
+   The final parameters of every channel fit are stored under the channel (histogram) name,
+   so that the next calibration of the same SiPMs can start from them instead of from the
+   generic start values.  The file is rewritten as a whole through a temporary file and a
+   rename, a job which dies while saving leaves the previous version in place.
+
+   FitParameterStore store("mipFitsSiPM.fitpars");
+   FitParameterStore::Entry seed;
+   if(store.get(name, seed)) ...warm start from seed.par, seed.err...
+   store.put(name, entry);
+   store.save();
+
+   Like the histogram checkpoints this is a native byte order file for one machine.
+ */
+
+class FitParameterStore
+{
+public:
+    struct Entry
+    {
+        std::vector<double> par;
+        std::vector<double> err;
+        //deviance and number of bins of the fit the parameters come from
+        double chi2;
+        int32_t nBins;
+    };
+
+    //Reads fileName if it exists, an unreadable or foreign file is an error
+    explicit FitParameterStore(const std::string& fileName);
+
+    const std::string& getFileName() const { return fileName_; }
+    int size() const { return entries_.size(); }
+
+    //false if there is nothing stored for the channel
+    bool get(const std::string& channel, Entry& entry) const;
+
+    void put(const std::string& channel, const Entry& entry) { entries_[channel] = entry; }
+
+    //Write all entries to fileName
+    void save() const;
+
+private:
+    std::string fileName_;
+    std::map<std::string, Entry> entries_;
+};
+
+#endif
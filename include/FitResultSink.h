@@ -0,0 +1,102 @@
+#ifndef FIT_RESULT_SINK_H
+#define FIT_RESULT_SINK_H
+
+#include "NTRException.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string>
+#include <utility>
+
+class TFile;
+class TTree;
+
+/* Calibration results of many concurrent fits, written by one thread
+
+   Fitting threads hand their results to push(), which only links the record into a
+   lock-free list and returns; it never waits for the writer or for I/O.  A writer thread
+   takes everything queued so far in one exchange, and fills the records in the order they
+   were pushed into one tree of its own file, which no other thread touches until close().
+   The tree has a column per quantity:
+
+   cName           channel (histogram) name
+   status, chi2, nBins
+   nPar, par[nPar], err[nPar]
+   nCov, cov[nCov] covariance of par, nPar x nPar row major
+
+   Named parameters can be stored as aliases of the tree, e.g. {"gain", "par[7]"}.
+
+   FitResultSink sink("calibration.root", "calibration", {{"gain", "par[7]"}});
+   ...from any thread: sink.push({name, par, err, cov, chi2, nBins, status});
+   sink.close();
+ */
+
+class FitResultSink
+{
+public:
+    struct Record
+    {
+        std::string name;
+        std::vector<double> par, err, cov;
+        double chi2;
+        int nBins;
+        int status;
+    };
+
+    FitResultSink(const std::string& fileName, const std::string& treeName, const std::vector<std::pair<std::string, std::string>>& aliases = {});
+    //Closes the file if close() was not called, without reporting errors
+    ~FitResultSink();
+
+    FitResultSink(const FitResultSink&) = delete;
+    FitResultSink& operator=(const FitResultSink&) = delete;
+
+    //Queue a record for writing, from any thread and until close(); err must have the size of
+    //par and cov its square
+    void push(const Record& record);
+
+    //Write everything pushed so far and close the file; pushes under way are waited for, later
+    //ones throw.  An error of the writer is reported here
+    void close();
+
+    const std::string& getFileName() const { return fileName_; }
+    //records written and the number of batches the writer took them in, complete after close()
+    long getNWritten() const { return nWritten_; }
+    long getNBatches() const { return nBatches_; }
+
+private:
+    struct Node
+    {
+        Record record;
+        Node* next;
+    };
+
+    std::string fileName_;
+    TFile* file_;
+    TTree* tree_;
+    std::atomic<Node*> head_;
+    //pushes under way, refused once closing, and no push left for the writer's last batch
+    std::atomic<int> nPushing_;
+    std::atomic<bool> closing_;
+    std::atomic<bool> drained_;
+    std::thread writer_;
+    bool closed_;
+    std::string error_;
+    long nWritten_;
+    long nBatches_;
+
+    //Branch buffers
+    std::string name_;
+    int status_;
+    double chi2_;
+    int nBins_;
+    int nPar_;
+    int nCov_;
+    std::vector<double> par_, err_, cov_;
+
+    void write();
+    void fill(const Record& record);
+    void finish();
+};
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef HIST_BOOKING_H
+#define HIST_BOOKING_H
+
+#include "NTRException.h"
+#include "NTupleReader.h"
+#include "ADCHist.h"
+
+#include <vector>
+#include <string>
+#include <set>
+#include <functional>
+
+/* Declarative booking of per-channel histograms for several boards and products
+
+   Boards, their channel ranges and the products (branch, binning, ADC window, optional
+   event selection) are declared up front, in code or in a text file:
+
+     # board <name> [<firstChannel> <lastChannel>]
+     board FERS_Board3
+     board FERS_Board11 0 31
+     # product <name> <branchSuffix> <u16|f32> <nBins> <xMin> <xMax> [window <min> <max>] [select <branch> <type> <value>] [fit]
+     # product <name> <branchSuffix> <u16|f32> edges <e0,e1,...>    [window <min> <max>] [select <branch> <type> <value>] [fit]
+     # (window only for u16)
+     product HG energyHG u16 1000 0 2000 window 21 4999 fit
+     product LG energyLG u16 1000 0 8000
+
+   u16 products are ADC codes, binned through the lookup table of ADCHist and cut to the ADC
+   window; f32 products (times, charges, ...) are binned by their value and take no window.
+   The branch of a product on a board is <board>_<branchSuffix>.  All products are filled
+   in the same pass over the events; the branches are resolved once per NTupleReader.
+
+   HistBooking booking;
+   booking.load("booking.cfg");
+   NTupleReader tr(ch, booking.getActiveBranches());
+   std::vector<ADCHist> hists = booking.book();
+   HistBooking::Filler filler(booking, tr);
+   while(tr.getNextEvent()) filler.fill(hists);
+ */
+
+class HistBooking
+{
+public:
+    struct BoardDef
+    {
+        std::string name;
+        int firstChannel;
+        int lastChannel;   //-1: all channels found in the first event
+    };
+
+    struct ProductDef
+    {
+        enum class ValueType { UShort, Float };
+
+        std::string name;
+        std::string branchSuffix;
+        ValueType type;
+        int nBins;
+        double xMin, xMax;
+        std::vector<double> binEdges;   //variable binning if not empty
+        unsigned short adcMin, adcMax;
+        std::string selectBranch;       //only events with selectBranch == selectValue, if set
+        std::string selectType;
+        double selectValue;
+        bool fit;
+
+        ProductDef();
+    };
+
+    HistBooking();
+
+    void addBoard(const std::string& name, const int firstChannel = 0, const int lastChannel = -1);
+    void addProduct(const ProductDef& product);
+
+    //Read board and product declarations from a text file
+    void load(const std::string& configName);
+
+    const std::vector<BoardDef>& getBoards() const { return boards_; }
+    const std::vector<ProductDef>& getProducts() const { return products_; }
+
+    //Every branch any product or selection reads
+    std::set<std::string> getActiveBranches() const;
+
+    std::string getBranchName(const int iBoard, const int iProduct) const { return boards_.at(iBoard).name + "_" + products_.at(iProduct).branchSuffix; }
+
+    //One ADCHist per board and product, named <board>_<product>, board-major
+    std::vector<ADCHist> book() const;
+    int getIndex(const int iBoard, const int iProduct) const { return iBoard*products_.size() + iProduct; }
+
+    //Canonical text of the booking, identical bookings give identical strings
+    std::string getConfigString() const;
+
+    //Branches of a booking resolved against one reader, fills all products of the current event
+    class Filler
+    {
+    public:
+        Filler(const HistBooking& booking, const NTupleReader& tr);
+
+        void fill(std::vector<ADCHist>& hists) const;
+
+    private:
+        struct Slot
+        {
+            int iHist;
+            int firstChannel;
+            ProductDef::ValueType type;
+            const void* vecSlot;    //std::vector<T>** owned by the reader, stable between events
+            int iSelect;
+        };
+
+        std::vector<Slot> slots_;
+        std::vector<std::function<bool()>> selections_;
+        mutable std::vector<char> selected_;
+    };
+
+private:
+    std::vector<BoardDef> boards_;
+    std::vector<ProductDef> products_;
+};
+
+#endif
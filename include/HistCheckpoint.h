@@ -0,0 +1,63 @@
+#ifndef HIST_CHECKPOINT_H
+#define HIST_CHECKPOINT_H
+
+#include "NTRException.h"
+#include "ADCHist.h"
+
+#include "TTree.h"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+/* Per-file checkpoints of booked ADC histograms
+
+   The counts of every histogram filled from one input file are stored in a checkpoint
+   file in dirName.  A checkpoint is keyed by the booking configuration and by the
+   identity of the input file (name, tree, size and modification time), so a later job
+   with the same booking only has to read the files which are new or changed and can add
+   the cached counts of all others.  Files without a local size (xrootd etc.) are never
+   cached.
+
+   HistCheckpoint checkpoint("mipFitsSiPM.ckpt", booking.getConfigString());
+   std::vector<ADCHist> fileHists = booking.book();
+   if(!checkpoint.load(fileName, treeName, fileHists))
+   {
+       ...fill fileHists from fileName...
+       checkpoint.save(fileName, treeName, fileHists);
+   }
+
+   The checkpoints are plain binary dumps of the counts in native byte order, they are a
+   cache for one machine and not an exchange format.
+ */
+
+class HistCheckpoint
+{
+public:
+    HistCheckpoint(const std::string& dirName, const std::string& configString);
+
+    const std::string& getDirName() const { return dirName_; }
+
+    //Checkpoint file used for one input file
+    std::string getCheckpointName(const std::string& fileName, const std::string& treeName) const;
+
+    //Replace the counts of the booked hists with the cached counts of the file;
+    //false (hists untouched) if there is no valid checkpoint for this booking and file version
+    bool load(const std::string& fileName, const std::string& treeName, std::vector<ADCHist>& hists) const;
+
+    //Store the counts filled from one file
+    void save(const std::string& fileName, const std::string& treeName, const std::vector<ADCHist>& hists) const;
+
+    //Size and modification time of a local file, false if there is none
+    static bool getFileIdentity(const std::string& fileName, Long64_t& fileSize, Long64_t& modTime);
+
+private:
+    std::string dirName_;
+    std::string configString_;
+    uint64_t configHash_;
+
+    //FNV-1a, stable between runs and compilers unlike std::hash
+    static uint64_t hash(const std::string& str);
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef HIST_SHARDS_H
+#define HIST_SHARDS_H
+
+#include "ADCHist.h"
+
+#include "TH1D.h"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <utility>
+#include <functional>
+
+/* Thread-sharded histogram filling
+
+   TH1D (and ADCHist) can not be filled from several threads at once.  Each worker thread
+   fills its own copy (shard) of the board histograms and the shards are added up in shard
+   order afterwards.  The counts are integers, so the merged result is bit-identical for
+   any number of threads.
+
+   ADCHistShards shards(boards, nThreads);
+   shards.run([&](int iShard, std::vector<ADCHist>& myBoards) { ...fill myBoards... });
+   boards = shards.merge();
+ */
+
+//Named board/channel histograms as used for fitting
+typedef std::vector<std::pair<std::string, std::vector<std::shared_ptr<TH1D>>>> HistVec;
+
+class ADCHistShards
+{
+public:
+    ADCHistShards(const std::vector<ADCHist>& boards, const int nShards);
+
+    int getNShards() const { return shards_.size(); }
+    std::vector<ADCHist>& getShard(const int iShard) { return shards_.at(iShard); }
+
+    //Run func(iShard, shard) on one thread per shard and wait for all of them; 
+    //an exception thrown by any worker is rethrown here
+    void run(const std::function<void(int, std::vector<ADCHist>&)>& func);
+
+    //Sum of all shards, always added in shard order
+    std::vector<ADCHist> merge() const;
+
+private:
+    std::vector<std::vector<ADCHist>> shards_;
+};
+
+//Add hists to sum histogram by histogram, histograms whose channel count is still unknown are skipped
+void addADCHists(std::vector<ADCHist>& sum, const std::vector<ADCHist>& hists);
+
+//Convert the merged boards into the hVec structure used for fitting
+HistVec toHistVec(const std::vector<ADCHist>& boards);
+
+//Add up hVec shards (same boards, channels and binning) in shard order
+HistVec mergeHistVecs(const std::vector<HistVec>& shards);
+
+#endif
@@ -2,6 +2,7 @@
 #define NTUPLE_READER_H
 
 #include "NTRException.h"
+#include "ChainEntryIndex.h"
 
 #include "TLorentzVector.h"
 #include "TBranch.h"
@@ -17,6 +18,7 @@
 #include <typeinfo>
 #include <typeindex>
 #include <functional>
+#include <list>
 #include <cxxabi.h>
 
 #ifdef __CINT__
@@ -313,6 +315,13 @@ public:
 
     int getNEntries() const;
 
+    //Cheap entry count: files of a TChain which were not read yet are estimated and "exact" is false
+    Long64_t getNEntries(bool& exact) const;
+
+    //Per-file entry counts, can be loaded from/saved next to the file list
+    ChainEntryIndex& getEntryIndex() { return entryIndex_; }
+    const ChainEntryIndex& getEntryIndex() const { return entryIndex_; }
+
     NTupleReaderIterator begin()
     {
         return NTupleReaderIterator(*this, 0);
@@ -344,6 +353,36 @@ public:
 
     bool goToEvent(int evt);
     bool getNextEvent();
+
+    //Random access mode keeps the last basketsPerBranch decompressed baskets of each active branch 
+    //in memory (LRU) so that out-of-order goToEvent calls do not decompress the same basket twice
+    void setRandomAccess(const bool randomAccess = true, const int basketsPerBranch = 8);
+    bool isRandomAccess() const { return randomAccess_; }
+
+    //Batched out-of-order access: the events are read in basket order and f(tr) is evaluated for each 
+    //of them, the results are returned in the order of evts.  Events which can not be read give T().
+    template<typename F> auto readEvents(const std::vector<int>& evts, F&& f) -> std::vector<typename std::decay<decltype(f(*this))>::type>
+    {
+        typedef typename std::decay<decltype(f(*this))>::type result_type;
+        std::vector<result_type> results(evts.size());
+
+        const std::vector<unsigned int> order = sortByBasket(evts);
+        for(unsigned int i = 0; i < order.size(); ++i)
+        {
+            const unsigned int iEvt = order[i];
+            //duplicate requests are neighbours after sorting, no need to read them again
+            if(i > 0 && evts[order[i - 1]] == evts[iEvt])
+            {
+                results[iEvt] = results[order[i - 1]];
+            }
+            else if(goToEvent(evts[iEvt]))
+            {
+                results[iEvt] = f(*this);
+            }
+        }
+        return results;
+    }
+
     void disableUpdate();
     void printTupleMembers(FILE *f = stdout) const;
     void printUsedTupleVar(FILE *f = stdout) const;
@@ -628,6 +667,17 @@ private:
     TTree *tree_;
     int nevt_, evtProcessed_, chainCurrentTree_;
     bool isUpdateDisabled_, reThrow_, convertHackActive_;
+
+    // basket cache used in random access mode 
+    bool randomAccess_;
+    int basketsPerBranch_;
+    Long64_t defaultMaxVirtualSize_;
+    int basketCacheTreeNumber_;
+    std::vector<TBranch*> basketCacheBranches_;
+    std::unordered_map<TBranch*, std::list<int>> basketLRU_;
+
+    // lazily filled per-file entry counts 
+    mutable ChainEntryIndex entryIndex_;
     
     // stl collections to hold branch list and associated info
     mutable std::unordered_map<std::string, Handle> branchMap_;
@@ -655,6 +705,14 @@ private:
 
     bool goToEventInternal(int evt, const bool filter);
 
+    std::vector<unsigned int> sortByBasket(const std::vector<int>& evts) const;
+
+    void resetBasketCache();
+
+    void updateBasketCache();
+
+    void dropBasket(TBranch * const branch, const int iBasket);
+
     template<typename T> void registerBranch(const std::string& name, bool activate = true) const
     {
         typeMap_[name] = demangle<T>();
@@ -0,0 +1,42 @@
+#ifndef PROCESS_POOL_H
+#define PROCESS_POOL_H
+
+#include "NTRException.h"
+
+#include <functional>
+
+/* Pool of forked worker processes for tasks which must not run in threads of one process
+
+   ROOT graphics (canvases, pads, the PDF and image writers) keep global state and are not
+   thread-safe, so work like rendering the plots of many channels is spread over processes
+   instead.  run() forks one child per worker, child iWorker runs the tasks iWorker,
+   iWorker + nProcesses, ... in order and exits; the parent waits for all of them.  The
+   children see a copy of the memory of the parent at the time of the fork, so the task
+   inputs are simply captured by the task, but nothing a task changes is seen by the parent:
+   results have to go to files.
+
+   Fork only where no other thread of the process is running (e.g. between two
+   WorkStealingPool runs).  The children leave with _exit(), without the static destructors
+   and ROOT's cleanup, so that files opened by the parent are not written or closed by them.
+
+   ProcessPool pool(nProcesses);
+   pool.run(nTasks, [&](int iTask) { render(descriptions[iTask]); });
+ */
+
+class ProcessPool
+{
+public:
+    explicit ProcessPool(const int nProcesses);
+
+    int getNProcesses() const { return nProcesses_; }
+
+    //Run task(iTask) for every iTask in [0, nTasks) in the children and wait for all of them;
+    //a child continues with its next task after a failed one, the failures are reported here
+    //as one exception after all children are done
+    void run(const int nTasks, const std::function<void(int)>& task);
+
+private:
+    int nProcesses_;
+};
+
+#endif
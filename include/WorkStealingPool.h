@@ -0,0 +1,54 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include "NTRException.h"
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <functional>
+
+/* Work-stealing thread pool for independent tasks of very different cost
+
+   The task indices are dealt round robin onto one deque per worker.  A worker takes its
+   own tasks from the front of its deque and, once that is empty, steals from the back of
+   the fullest other deque, so a few slow tasks (e.g. channel fits which need many Minuit
+   iterations) do not leave the other threads idle.  Tasks must not share mutable state;
+   results go to per-task slots so that their order does not depend on the scheduling.
+
+   WorkStealingPool pool(nThreads);
+   std::vector<Result> results(nTasks);
+   pool.run(nTasks, [&](int iTask) { results[iTask] = work(iTask); });
+ */
+
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool(const int nThreads);
+
+    int getNThreads() const { return nThreads_; }
+
+    //Run task(iTask) for every iTask in [0, nTasks) and wait for all of them; the exception
+    //of the lowest failed task is rethrown here, the remaining tasks still run
+    void run(const int nTasks, const std::function<void(int)>& task);
+
+    //Number of tasks the last run took from another worker's deque
+    int getNStolen() const { return nStolen_; }
+
+private:
+    struct TaskQueue
+    {
+        std::mutex mutex;
+        std::deque<int> tasks;
+    };
+
+    int nThreads_;
+    int nStolen_;
+    std::vector<std::unique_ptr<TaskQueue>> queues_;
+
+    //Next task for worker iWorker, false once all deques are empty
+    bool next(const int iWorker, int& iTask, bool& stolen);
+};
+
+#endif
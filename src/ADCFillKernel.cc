@@ -0,0 +1,145 @@
+#include "../include/ADCFillKernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ADC_FILL_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    typedef void (*FillFunc)(const unsigned short*, const int, const uint32_t*, uint32_t*, const int, const uint32_t, const unsigned short, const unsigned short);
+
+    void fillScalar(const unsigned short* adc, const int nChannels, const uint32_t* lut, uint32_t* counts, const int stride, const uint32_t discardBin, const unsigned short adcMin, const unsigned short adcMax)
+    {
+        for(int c = 0; c < nChannels; ++c)
+        {
+            const uint32_t bin = (adc[c] >= adcMin && adc[c] <= adcMax) ? lut[adc[c]] : discardBin;
+            ++counts[c*stride + bin];
+        }
+    }
+
+#ifdef ADC_FILL_KERNEL_X86
+    __attribute__((target("avx2")))
+    void fillAVX2(const unsigned short* adc, const int nChannels, const uint32_t* lut, uint32_t* counts, const int stride, const uint32_t discardBin, const unsigned short adcMin, const unsigned short adcMax)
+    {
+        //ADC codes are widened to 32 bit, so signed compares are safe
+        const __m256i lo      = _mm256_set1_epi32(int(adcMin) - 1);
+        const __m256i hi      = _mm256_set1_epi32(int(adcMax) + 1);
+        const __m256i discard = _mm256_set1_epi32(discardBin);
+        const __m256i laneRow = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+        alignas(32) uint32_t idx[8];
+
+        int c = 0;
+        for(; c + 8 <= nChannels; c += 8)
+        {
+            const __m256i code   = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(adc + c)));
+            const __m256i inWin  = _mm256_and_si256(_mm256_cmpgt_epi32(code, lo), _mm256_cmpgt_epi32(hi, code));
+            const __m256i bin    = _mm256_blendv_epi8(discard, _mm256_i32gather_epi32(reinterpret_cast<const int*>(lut), code, 4), inWin);
+            const __m256i offset = _mm256_add_epi32(_mm256_add_epi32(laneRow, _mm256_set1_epi32(c*stride)), bin);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(idx), offset);
+
+            //AVX2 has no scatter; every lane is a different channel row so there are no conflicts
+            for(int i = 0; i < 8; ++i) ++counts[idx[i]];
+        }
+
+        fillScalar(adc + c, nChannels - c, lut, counts + c*stride, stride, discardBin, adcMin, adcMax);
+    }
+
+    __attribute__((target("avx512f")))
+    void fillAVX512(const unsigned short* adc, const int nChannels, const uint32_t* lut, uint32_t* counts, const int stride, const uint32_t discardBin, const unsigned short adcMin, const unsigned short adcMax)
+    {
+        const __m512i lo      = _mm512_set1_epi32(adcMin);
+        const __m512i hi      = _mm512_set1_epi32(adcMax);
+        const __m512i discard = _mm512_set1_epi32(discardBin);
+        const __m512i one     = _mm512_set1_epi32(1);
+        const __m512i laneRow = _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), _mm512_set1_epi32(stride));
+
+        int c = 0;
+        for(; c + 16 <= nChannels; c += 16)
+        {
+            const __m512i code   = _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(adc + c)));
+            const __mmask16 inWin = _mm512_cmpge_epu32_mask(code, lo) & _mm512_cmple_epu32_mask(code, hi);
+            const __m512i bin    = _mm512_mask_i32gather_epi32(discard, inWin, code, lut, 4);
+            const __m512i offset = _mm512_add_epi32(_mm512_add_epi32(laneRow, _mm512_set1_epi32(c*stride)), bin);
+
+            //one row per lane, so gather-add-scatter never hits the same address twice
+            const __m512i count  = _mm512_i32gather_epi32(offset, counts, 4);
+            _mm512_i32scatter_epi32(counts, offset, _mm512_add_epi32(count, one), 4);
+        }
+
+        fillScalar(adc + c, nChannels - c, lut, counts + c*stride, stride, discardBin, adcMin, adcMax);
+    }
+#endif
+
+    FillFunc getFillFunc(const ADCFillKernel kernel)
+    {
+        switch(kernel)
+        {
+#ifdef ADC_FILL_KERNEL_X86
+        case ADCFillKernel::AVX512: return fillAVX512;
+        case ADCFillKernel::AVX2:   return fillAVX2;
+#endif
+        default:                    return fillScalar;
+        }
+    }
+
+    ADCFillKernel bestKernel()
+    {
+        if(isADCFillKernelSupported(ADCFillKernel::AVX512)) return ADCFillKernel::AVX512;
+        if(isADCFillKernelSupported(ADCFillKernel::AVX2))   return ADCFillKernel::AVX2;
+        return ADCFillKernel::Scalar;
+    }
+
+    ADCFillKernel& currentKernel()
+    {
+        static ADCFillKernel kernel = bestKernel();
+        return kernel;
+    }
+
+    FillFunc& currentFillFunc()
+    {
+        static FillFunc func = getFillFunc(currentKernel());
+        return func;
+    }
+}
+
+void fillADCBoard(const unsigned short* adc, const int nChannels, const uint32_t* lut, uint32_t* counts, const int stride, const uint32_t discardBin, const unsigned short adcMin, const unsigned short adcMax)
+{
+    currentFillFunc()(adc, nChannels, lut, counts, stride, discardBin, adcMin, adcMax);
+}
+
+ADCFillKernel getADCFillKernel()
+{
+    return currentKernel();
+}
+
+bool setADCFillKernel(const ADCFillKernel kernel)
+{
+    if(!isADCFillKernelSupported(kernel)) return false;
+    currentKernel() = kernel;
+    currentFillFunc() = getFillFunc(kernel);
+    return true;
+}
+
+bool isADCFillKernelSupported(const ADCFillKernel kernel)
+{
+    switch(kernel)
+    {
+#ifdef ADC_FILL_KERNEL_X86
+    case ADCFillKernel::AVX512: return __builtin_cpu_supports("avx512f");
+    case ADCFillKernel::AVX2:   return __builtin_cpu_supports("avx2");
+#endif
+    case ADCFillKernel::Scalar: return true;
+    default:                    return false;
+    }
+}
+
+std::string getADCFillKernelName(const ADCFillKernel kernel)
+{
+    switch(kernel)
+    {
+    case ADCFillKernel::AVX512: return "AVX-512";
+    case ADCFillKernel::AVX2:   return "AVX2";
+    default:                    return "scalar";
+    }
+}
@@ -0,0 +1,102 @@
+#include "../include/ADCHist.h"
+
+#include <cmath>
+
+ADCHist::ADCHist() : name_(""), nChannels_(0), nBins_(0), stride_(0), discardBin_(0), xMin_(0), xMax_(0), adcMin_(0), adcMax_(0)
+{
+}
+
+ADCHist::ADCHist(const std::string& name, const int nChannels, const int nBins, const double xMin, const double xMax, const unsigned short adcMin, const unsigned short adcMax) 
+    : name_(name), nChannels_(0), nBins_(nBins), stride_(0), discardBin_(0), xMin_(xMin), xMax_(xMax), adcMin_(adcMin), adcMax_(adcMax)
+{
+    if(nBins_ < 1 || !(xMin_ < xMax_)) THROW_NTREXCEPTION("Invalid binning for \"" + name_ + "\": " + std::to_string(nBins_) + " bins in [" + std::to_string(xMin_) + ", " + std::to_string(xMax_) + ")");
+
+    lut_.resize(nADCCodes);
+    for(int adc = 0; adc < nADCCodes; ++adc) lut_[adc] = findBin(adc);
+
+    init(nChannels);
+}
+
+ADCHist::ADCHist(const std::string& name, const int nChannels, const std::vector<double>& binEdges, const unsigned short adcMin, const unsigned short adcMax) 
+    : name_(name), nChannels_(0), nBins_(binEdges.size() - 1), stride_(0), discardBin_(0), adcMin_(adcMin), adcMax_(adcMax), binEdges_(binEdges)
+{
+    if(binEdges_.size() < 2 || !std::is_sorted(binEdges_.begin(), binEdges_.end())) THROW_NTREXCEPTION("Invalid bin edges for \"" + name_ + "\"");
+    xMin_ = binEdges_.front();
+    xMax_ = binEdges_.back();
+
+    lut_.resize(nADCCodes);
+    for(int adc = 0; adc < nADCCodes; ++adc) lut_[adc] = findBin(adc);
+
+    init(nChannels);
+}
+
+void ADCHist::init(const int nChannels)
+{
+    //underflow, nBins bins, overflow and one slot for hits outside the ADC window
+    stride_ = nBins_ + 3;
+    discardBin_ = nBins_ + 2;
+    setNChannels(nChannels);
+}
+
+uint32_t ADCHist::findBin(const double x) const
+{
+    //same bin assignment as TAxis::FindBin for fixed and variable bins
+    if(std::isnan(x))     return discardBin_;
+    if(x < xMin_)         return 0;
+    if(!(x < xMax_))      return nBins_ + 1;
+    if(binEdges_.empty()) return 1 + int(nBins_*(x - xMin_)/(xMax_ - xMin_));
+    return std::upper_bound(binEdges_.begin(), binEdges_.end(), x) - binEdges_.begin();
+}
+
+void ADCHist::setNChannels(const int nChannels)
+{
+    if(nChannels < 0) THROW_NTREXCEPTION("Invalid number of channels for \"" + name_ + "\": " + std::to_string(nChannels));
+    nChannels_ = nChannels;
+    counts_.assign(static_cast<size_t>(nChannels_)*stride_, 0);
+}
+
+void ADCHist::add(const ADCHist& other)
+{
+    if(other.nChannels_ != nChannels_ || other.stride_ != stride_ || other.lut_ != lut_) 
+    {
+        THROW_NTREXCEPTION("Cannot add \"" + other.name_ + "\" to \"" + name_ + "\": different channels or binning");
+    }
+
+    for(size_t i = 0; i < counts_.size(); ++i) counts_[i] += other.counts_[i];
+}
+
+void ADCHist::reset()
+{
+    std::fill(counts_.begin(), counts_.end(), 0);
+}
+
+uint64_t ADCHist::getEntries(const int channel) const
+{
+    uint64_t nEntries = 0;
+    for(int bin = 0; bin <= nBins_ + 1; ++bin) nEntries += getBinContent(channel, bin);
+    return nEntries;
+}
+
+std::shared_ptr<TH1D> ADCHist::toTH1D(const int channel, const std::string& histName) const
+{
+    if(channel < 0 || channel >= nChannels_) THROW_NTREXCEPTION("Channel " + std::to_string(channel) + " out of range for \"" + name_ + "\"");
+
+    const std::string hName = histName.empty() ? getChannelName(channel) : histName;
+
+    std::shared_ptr<TH1D> h;
+    if(binEdges_.empty()) h = std::make_shared<TH1D>(hName.c_str(), hName.c_str(), nBins_, xMin_, xMax_);
+    else                  h = std::make_shared<TH1D>(hName.c_str(), hName.c_str(), nBins_, binEdges_.data());
+    //owned by the shared_ptr, not by whatever directory is current
+    h->SetDirectory(nullptr);
+
+    //unit weight fills: the error of each bin is sqrt(N) as for TH1::Fill
+    for(int bin = 0; bin <= nBins_ + 1; ++bin)
+    {
+        const double content = getBinContent(channel, bin);
+        h->SetBinContent(bin, content);
+        h->SetBinError(bin, std::sqrt(content));
+    }
+    h->SetEntries(getEntries(channel));
+
+    return h;
+}
@@ -0,0 +1,43 @@
+#ifndef BINARY_IO_H
+#define BINARY_IO_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <cstdint>
+#include <limits>
+
+/* Raw native byte order reads and writes of the cache files (HistCheckpoint,
+   FitParameterStore), internal to the library.  A string is its uint32_t size followed by
+   its characters; the read functions return false on a short read.
+ */
+
+namespace BinaryIO
+{
+    template<typename T> void writeValue(std::ostream& out, const T& value)
+    {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T> bool readValue(std::istream& in, T& value)
+    {
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+
+    inline void writeString(std::ostream& out, const std::string& str)
+    {
+        writeValue<uint32_t>(out, str.size());
+        out.write(str.data(), str.size());
+    }
+
+    //false as well for a size above maxSize, which is a corrupt file rather than a string
+    inline bool readString(std::istream& in, std::string& str, const uint32_t maxSize = std::numeric_limits<uint32_t>::max())
+    {
+        uint32_t size;
+        if(!readValue(in, size) || size > maxSize) return false;
+        str.resize(size);
+        return size == 0 || static_cast<bool>(in.read(&str[0], size));
+    }
+}
+
+#endif
@@ -0,0 +1,258 @@
+#include "../include/ChainEntryIndex.h"
+
+#include "TFile.h"
+#include "TChain.h"
+#include "TChainElement.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <cstdio>
+#include <sys/stat.h>
+
+ChainEntryIndex::ChainEntryIndex() : tree_(nullptr), nExactFiles_(0), nExactEntries_(0), firstEstimated_(0), firstEntriesValid_(false)
+{
+}
+
+ChainEntryIndex::ChainEntryIndex(TTree * tree) : tree_(nullptr), nExactFiles_(0), nExactEntries_(0), firstEstimated_(0), firstEntriesValid_(false)
+{
+    setTree(tree);
+}
+
+void ChainEntryIndex::setTree(TTree * tree)
+{
+    tree_ = tree;
+    files_.clear();
+    nExactFiles_ = 0;
+    nExactEntries_ = 0;
+    firstEntriesValid_ = false;
+    if(!tree_) return;
+
+    if(tree_->InheritsFrom(TChain::Class()))
+    {
+        //Only the names are needed here, no file is opened
+        TIter next(static_cast<TChain*>(tree_)->GetListOfFiles());
+        TChainElement *element;
+        while((element = (TChainElement*)next()))
+        {
+            files_.push_back({element->GetTitle(), element->GetName(), -1, -1, false});
+        }
+        update();
+    }
+    else
+    {
+        //A plain TTree is already open, its count is free
+        std::string fileName = tree_->GetCurrentFile() ? tree_->GetCurrentFile()->GetName() : "";
+        files_.push_back({fileName, tree_->GetName(), -1, -1, false});
+        setNEntries(0, tree_->GetEntries());
+    }
+}
+
+Long64_t ChainEntryIndex::getNEntries(const int iFile, bool& exact) const
+{
+    const auto& file = files_.at(iFile);
+    exact = file.exact;
+    return file.exact ? file.nEntries : estimatedEntries();
+}
+
+Long64_t ChainEntryIndex::getNEntries(bool& exact) const
+{
+    return getFirstEntry(getNFiles(), exact);
+}
+
+bool ChainEntryIndex::isExact() const
+{
+    return nExactFiles_ == getNFiles();
+}
+
+int ChainEntryIndex::getNExactFiles() const
+{
+    return nExactFiles_;
+}
+
+Long64_t ChainEntryIndex::getFirstEntry(const int iFile, bool& exact) const
+{
+    if(iFile < 0 || iFile > getNFiles()) THROW_NTREXCEPTION("File index " + std::to_string(iFile) + " out of range (" + std::to_string(getNFiles()) + " files)");
+
+    updateFirstEntries();
+    exact = iFile <= firstEstimated_;
+    return firstEntries_[iFile];
+}
+
+std::vector<std::pair<Long64_t, Long64_t>> ChainEntryIndex::partition(const int nRanges, bool& exact) const
+{
+    if(nRanges < 1) THROW_NTREXCEPTION("Cannot partition the chain into " + std::to_string(nRanges) + " ranges");
+
+    const Long64_t nEntries = getNEntries(exact);
+    std::vector<std::pair<Long64_t, Long64_t>> ranges;
+    for(int i = 0; i < nRanges; ++i)
+    {
+        ranges.emplace_back(nEntries*i/nRanges, nEntries*(i + 1)/nRanges);
+    }
+
+    //With estimated counts the last range is left open so that no entry is lost
+    if(!exact) ranges.back().second = TTree::kMaxEntries;
+
+    return ranges;
+}
+
+void ChainEntryIndex::setNEntries(const int iFile, const Long64_t nEntries)
+{
+    auto& file = files_.at(iFile);
+    if(file.exact)
+    {
+        nExactEntries_ -= file.nEntries;
+    }
+    else
+    {
+        ++nExactFiles_;
+    }
+    nExactEntries_ += nEntries;
+    file.nEntries = nEntries;
+    file.exact = true;
+    if(file.fileSize < 0) file.fileSize = getFileSize(file.fileName);
+    firstEntriesValid_ = false;
+}
+
+void ChainEntryIndex::update()
+{
+    if(!tree_ || !tree_->InheritsFrom(TChain::Class())) return;
+
+    //The chain fills its offsets as it loads files, unknown offsets are kMaxEntries
+    TChain* chain = static_cast<TChain*>(tree_);
+    const Long64_t* offsets = chain->GetTreeOffset();
+    const int nTrees = std::min(chain->GetNtrees(), getNFiles());
+    for(int i = 0; i < nTrees; ++i)
+    {
+        if(files_[i].exact) continue;
+        if(offsets[i] < TTree::kMaxEntries && offsets[i + 1] < TTree::kMaxEntries && offsets[i + 1] >= offsets[i])
+        {
+            setNEntries(i, offsets[i + 1] - offsets[i]);
+        }
+    }
+}
+
+Long64_t ChainEntryIndex::resolve(const int iFile)
+{
+    auto& file = files_.at(iFile);
+    if(file.exact) return file.nEntries;
+
+    TFile* f = TFile::Open(file.fileName.c_str());
+    if(!f || f->IsZombie())
+    {
+        delete f;
+        THROW_NTREXCEPTION("Cannot open file \"" + file.fileName + "\" to count its entries");
+    }
+
+    TTree* tree = dynamic_cast<TTree*>(f->Get(file.treeName.c_str()));
+    if(!tree)
+    {
+        delete f;
+        THROW_NTREXCEPTION("Tree \"" + file.treeName + "\" not found in file \"" + file.fileName + "\"");
+    }
+
+    setNEntries(iFile, tree->GetEntries());
+    f->Close();
+    delete f;
+
+    return file.nEntries;
+}
+
+void ChainEntryIndex::resolveAll()
+{
+    update();
+    for(int i = 0; i < getNFiles(); ++i) resolve(i);
+}
+
+void ChainEntryIndex::load(const std::string& indexName)
+{
+    std::ifstream in(indexName);
+    if(!in) return; //no index yet, everything stays an estimate
+
+    //files of the chain by tree and file name, so that a line costs no pass over the files
+    std::map<std::pair<std::string, std::string>, std::vector<int>> byName;
+    for(int i = 0; i < getNFiles(); ++i) byName[{files_[i].treeName, files_[i].fileName}].push_back(i);
+
+    std::string line;
+    while(std::getline(in, line))
+    {
+        if(line.empty() || line[0] == '#') continue;
+
+        //format: nEntries fileSize treeName fileName
+        std::istringstream ss(line);
+        Long64_t nEntries, fileSize;
+        std::string treeName, fileName;
+        if(!(ss >> nEntries >> fileSize >> treeName) || nEntries < 0) continue;
+        std::getline(ss >> std::ws, fileName);
+
+        const auto match = byName.find({treeName, fileName});
+        if(match == byName.end()) continue;
+        for(int i : match->second)
+        {
+            if(files_[i].exact) continue;
+
+            //a file which changed size since the index was written has to be counted again
+            const Long64_t currentSize = getFileSize(fileName);
+            if(fileSize >= 0 && currentSize >= 0 && fileSize != currentSize) continue;
+
+            setNEntries(i, nEntries);
+        }
+    }
+}
+
+void ChainEntryIndex::save(const std::string& indexName) const
+{
+    //write to a temporary file first so that an interrupted job never leaves a truncated index
+    const std::string tmpName = indexName + ".tmp";
+    {
+        std::ofstream out(tmpName);
+        if(!out) THROW_NTREXCEPTION("Cannot write entry index \"" + tmpName + "\"");
+
+        out << "# nEntries fileSize treeName fileName" << std::endl;
+        for(const auto& file : files_)
+        {
+            if(file.exact) out << file.nEntries << " " << file.fileSize << " " << file.treeName << " " << file.fileName << std::endl;
+        }
+
+        //a failed write or final flush (e.g. a full disk) must not replace the previous index
+        out.close();
+        if(!out)
+        {
+            std::remove(tmpName.c_str());
+            THROW_NTREXCEPTION("Cannot write entry index \"" + tmpName + "\"");
+        }
+    }
+
+    if(std::rename(tmpName.c_str(), indexName.c_str()) != 0) THROW_NTREXCEPTION("Cannot move entry index to \"" + indexName + "\"");
+}
+
+Long64_t ChainEntryIndex::estimatedEntries() const
+{
+    //average over the files which were already counted
+    return nExactFiles_ ? nExactEntries_/nExactFiles_ : 0;
+}
+
+void ChainEntryIndex::updateFirstEntries() const
+{
+    if(firstEntriesValid_) return;
+
+    const Long64_t estimate = estimatedEntries();
+    firstEntries_.assign(getNFiles() + 1, 0);
+    firstEstimated_ = getNFiles();
+    for(int i = 0; i < getNFiles(); ++i)
+    {
+        const auto& file = files_[i];
+        if(!file.exact && firstEstimated_ == getNFiles()) firstEstimated_ = i;
+        firstEntries_[i + 1] = firstEntries_[i] + (file.exact ? file.nEntries : estimate);
+    }
+    firstEntriesValid_ = true;
+}
+
+Long64_t ChainEntryIndex::getFileSize(const std::string& fileName)
+{
+    //remote files (xrootd etc.) have no local size, -1 disables the check
+    struct stat buf;
+    if(fileName.empty() || stat(fileName.c_str(), &buf) != 0) return -1;
+    return buf.st_size;
+}
@@ -0,0 +1,94 @@
+#include "../include/FitParameterStore.h"
+#include "BinaryIO.h"
+
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+
+using namespace BinaryIO;
+
+namespace
+{
+    const char storeMagic[8] = {'F', 'I', 'T', 'P', 'A', 'R', 'S', '1'};
+
+    //sizes beyond these are a corrupt file, not a fit (which has a few dozen parameters at most)
+    const uint32_t maxValues = 4096;
+    const uint32_t maxNameSize = 4096;
+
+    void writeDoubles(std::ostream& out, const std::vector<double>& values)
+    {
+        writeValue<uint32_t>(out, values.size());
+        out.write(reinterpret_cast<const char*>(values.data()), values.size()*sizeof(double));
+    }
+
+    bool readDoubles(std::istream& in, std::vector<double>& values)
+    {
+        uint32_t size;
+        if(!readValue(in, size) || size > maxValues) return false;
+        values.resize(size);
+        return size == 0 || static_cast<bool>(in.read(reinterpret_cast<char*>(values.data()), size*sizeof(double)));
+    }
+}
+
+FitParameterStore::FitParameterStore(const std::string& fileName) : fileName_(fileName)
+{
+    std::ifstream in(fileName_, std::ios::binary);
+    //no store yet, the first job starts from the defaults
+    if(!in) return;
+
+    char magic[sizeof(storeMagic)];
+    uint32_t nEntries;
+    if(!in.read(magic, sizeof(magic)) || std::memcmp(magic, storeMagic, sizeof(magic)) != 0) THROW_NTREXCEPTION("\"" + fileName_ + "\" is not a fit parameter store");
+    if(!readValue(in, nEntries)) THROW_NTREXCEPTION("Fit parameter store \"" + fileName_ + "\" is truncated");
+
+    for(uint32_t i = 0; i < nEntries; ++i)
+    {
+        std::string name;
+        Entry entry;
+        const bool ok = readString(in, name, maxNameSize) && readDoubles(in, entry.par) && readDoubles(in, entry.err) && readValue(in, entry.chi2) && readValue(in, entry.nBins);
+        if(!ok) THROW_NTREXCEPTION("Fit parameter store \"" + fileName_ + "\" is truncated");
+        entries_[name] = entry;
+    }
+}
+
+bool FitParameterStore::get(const std::string& channel, Entry& entry) const
+{
+    const auto it = entries_.find(channel);
+    if(it == entries_.end()) return false;
+    entry = it->second;
+    return true;
+}
+
+void FitParameterStore::save() const
+{
+    const std::string tmpName = fileName_ + ".tmp";
+    {
+        std::ofstream out(tmpName, std::ios::binary);
+        if(!out) THROW_NTREXCEPTION("Cannot write fit parameter store \"" + tmpName + "\"");
+
+        out.write(storeMagic, sizeof(storeMagic));
+        writeValue<uint32_t>(out, entries_.size());
+        for(const auto& entry : entries_)
+        {
+            writeString(out, entry.first);
+            writeDoubles(out, entry.second.par);
+            writeDoubles(out, entry.second.err);
+            writeValue(out, entry.second.chi2);
+            writeValue(out, entry.second.nBins);
+        }
+
+        //the final flush can fail as well, e.g. on a full disk
+        out.close();
+        if(!out)
+        {
+            std::remove(tmpName.c_str());
+            THROW_NTREXCEPTION("Error writing fit parameter store \"" + tmpName + "\"");
+        }
+    }
+
+    if(std::rename(tmpName.c_str(), fileName_.c_str()) != 0)
+    {
+        std::remove(tmpName.c_str());
+        THROW_NTREXCEPTION("Cannot move fit parameter store to \"" + fileName_ + "\"");
+    }
+}
@@ -0,0 +1,154 @@
+#include "../include/FitResultSink.h"
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TDirectory.h"
+#include "TROOT.h"
+
+#include <chrono>
+
+FitResultSink::FitResultSink(const std::string& fileName, const std::string& treeName, const std::vector<std::pair<std::string, std::string>>& aliases)
+    : fileName_(fileName), file_(nullptr), tree_(nullptr), head_(nullptr), nPushing_(0), closing_(false), drained_(false), closed_(false), nWritten_(0), nBatches_(0),
+      status_(0), chi2_(0), nBins_(0), nPar_(0), nCov_(0), par_(1), err_(1), cov_(1)
+{
+    //the writer fills the tree alongside the ROOT objects of the other threads
+    ROOT::EnableThreadSafety();
+
+    //the file must not become the current directory of the calling thread
+    TDirectory::TContext context;
+    file_ = TFile::Open(fileName.c_str(), "RECREATE");
+    if(!file_ || file_->IsZombie())
+    {
+        delete file_;
+        THROW_NTREXCEPTION("Could not create the fit result file " + fileName);
+    }
+
+    tree_ = new TTree(treeName.c_str(), "Fit results per channel");
+    tree_->SetDirectory(file_);
+    tree_->Branch("cName", &name_);
+    tree_->Branch("status", &status_, "status/I");
+    tree_->Branch("chi2", &chi2_, "chi2/D");
+    tree_->Branch("nBins", &nBins_, "nBins/I");
+    tree_->Branch("nPar", &nPar_, "nPar/I");
+    tree_->Branch("par", par_.data(), "par[nPar]/D");
+    tree_->Branch("err", err_.data(), "err[nPar]/D");
+    tree_->Branch("nCov", &nCov_, "nCov/I");
+    tree_->Branch("cov", cov_.data(), "cov[nCov]/D");
+    for(const auto& alias : aliases) tree_->SetAlias(alias.first.c_str(), alias.second.c_str());
+
+    writer_ = std::thread(&FitResultSink::write, this);
+}
+
+FitResultSink::~FitResultSink()
+{
+    try
+    {
+        close();
+    }
+    catch(const NTRException&)
+    {
+    }
+}
+
+void FitResultSink::push(const Record& record)
+{
+    if(record.err.size() != record.par.size() || record.cov.size() != record.par.size()*record.par.size())
+    {
+        THROW_NTREXCEPTION("Fit result of " + record.name + " has " + std::to_string(record.par.size()) + " parameters, " + std::to_string(record.err.size()) +
+                           " errors and " + std::to_string(record.cov.size()) + " covariance elements");
+    }
+    //close() sees either this push in flight and waits for it, or push sees closing and refuses
+    ++nPushing_;
+    if(closing_)
+    {
+        --nPushing_;
+        THROW_NTREXCEPTION("Fit result of " + record.name + " pushed after closing " + fileName_);
+    }
+
+    Node* node = new Node{record, head_.load(std::memory_order_relaxed)};
+    while(!head_.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {}
+    --nPushing_;
+}
+
+void FitResultSink::close()
+{
+    if(closed_) return;
+    closed_ = true;
+    closing_ = true;
+    while(nPushing_ > 0) std::this_thread::yield();
+    drained_ = true;
+    writer_.join();
+    finish();
+    if(!error_.empty()) THROW_NTREXCEPTION(error_);
+}
+
+void FitResultSink::write()
+{
+    while(true)
+    {
+        //every record pushed before close() is in the list once drained is seen
+        const bool last = drained_.load(std::memory_order_acquire);
+        Node* batch = head_.exchange(nullptr, std::memory_order_acquire);
+        if(!batch)
+        {
+            if(last) return;
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            continue;
+        }
+
+        //the list is newest first
+        Node* ordered = nullptr;
+        while(batch)
+        {
+            Node* next = batch->next;
+            batch->next = ordered;
+            ordered = batch;
+            batch = next;
+        }
+        ++nBatches_;
+        while(ordered)
+        {
+            Node* next = ordered->next;
+            if(error_.empty()) fill(ordered->record);
+            delete ordered;
+            ordered = next;
+        }
+    }
+}
+
+void FitResultSink::fill(const Record& record)
+{
+    name_ = record.name;
+    status_ = record.status;
+    chi2_ = record.chi2;
+    nBins_ = record.nBins;
+    nPar_ = record.par.size();
+    nCov_ = record.cov.size();
+
+    //the array branches follow their buffers when these grow, cov_ stays the square of par_
+    if(par_.size() < record.par.size())
+    {
+        par_.resize(record.par.size());
+        err_.resize(record.par.size());
+        cov_.resize(record.cov.size());
+        tree_->SetBranchAddress("par", par_.data());
+        tree_->SetBranchAddress("err", err_.data());
+        tree_->SetBranchAddress("cov", cov_.data());
+    }
+    std::copy(record.par.begin(), record.par.end(), par_.begin());
+    std::copy(record.err.begin(), record.err.end(), err_.begin());
+    std::copy(record.cov.begin(), record.cov.end(), cov_.begin());
+
+    if(tree_->Fill() < 0) error_ = "Could not write the fit result of " + record.name + " to " + fileName_;
+    else ++nWritten_;
+}
+
+void FitResultSink::finish()
+{
+    TDirectory::TContext context(file_);
+    if(tree_->Write() == 0 && error_.empty()) error_ = "Could not write the fit results to " + fileName_;
+    file_->Close();
+    delete file_;
+    file_ = nullptr;
+    tree_ = nullptr;
+}
@@ -0,0 +1,288 @@
+#include "../include/HistBooking.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+HistBooking::ProductDef::ProductDef() : type(ValueType::UShort), nBins(0), xMin(0), xMax(0), adcMin(0), adcMax(ADCHist::nADCCodes - 1), selectValue(0), fit(false)
+{
+}
+
+HistBooking::HistBooking()
+{
+}
+
+void HistBooking::addBoard(const std::string& name, const int firstChannel, const int lastChannel)
+{
+    if(firstChannel < 0 || (lastChannel >= 0 && lastChannel < firstChannel))
+    {
+        THROW_NTREXCEPTION("Invalid channel range [" + std::to_string(firstChannel) + ", " + std::to_string(lastChannel) + "] for board \"" + name + "\"");
+    }
+    for(const auto& board : boards_) if(board.name == name) THROW_NTREXCEPTION("Board \"" + name + "\" is already booked");
+
+    boards_.push_back({name, firstChannel, lastChannel});
+}
+
+void HistBooking::addProduct(const ProductDef& product)
+{
+    if(product.binEdges.empty() && (product.nBins < 1 || !(product.xMin < product.xMax))) THROW_NTREXCEPTION("Invalid binning for product \"" + product.name + "\"");
+    if(product.adcMax < product.adcMin) THROW_NTREXCEPTION("Empty ADC window for product \"" + product.name + "\"");
+    //floating point products are binned by value, an ADC code window would cut e.g. negative times
+    if(product.type == ProductDef::ValueType::Float && (product.adcMin != 0 || product.adcMax != ADCHist::nADCCodes - 1))
+    {
+        THROW_NTREXCEPTION("ADC window for floating point product \"" + product.name + "\", only u16 products have ADC codes");
+    }
+    for(const auto& p : products_) if(p.name == product.name) THROW_NTREXCEPTION("Product \"" + product.name + "\" is already booked");
+
+    products_.push_back(product);
+}
+
+namespace
+{
+    //std::stod and std::stoi throw std::invalid_argument or std::out_of_range and accept trailing
+    //garbage, a bad number in the booking file is reported like every other syntax error
+    template<typename T> T parseNumber(const std::string& str, const std::string& where, T (*convert)(const std::string&, size_t*))
+    {
+        size_t end = 0;
+        T value;
+        try
+        {
+            value = convert(str, &end);
+        }
+        catch(const std::invalid_argument&)
+        {
+            THROW_NTREXCEPTION(where + ": \"" + str + "\" is not a number");
+        }
+        catch(const std::out_of_range&)
+        {
+            THROW_NTREXCEPTION(where + ": \"" + str + "\" is out of range");
+        }
+        if(end != str.size()) THROW_NTREXCEPTION(where + ": \"" + str + "\" is not a number");
+        return value;
+    }
+
+    double parseDouble(const std::string& str, const std::string& where)
+    {
+        return parseNumber<double>(str, where, [](const std::string& s, size_t* end) { return std::stod(s, end); });
+    }
+
+    int parseInt(const std::string& str, const std::string& where)
+    {
+        return parseNumber<int>(str, where, [](const std::string& s, size_t* end) { return std::stoi(s, end); });
+    }
+}
+
+void HistBooking::load(const std::string& configName)
+{
+    std::ifstream in(configName);
+    if(!in) THROW_NTREXCEPTION("Cannot open booking configuration \"" + configName + "\"");
+
+    std::string line;
+    int iLine = 0;
+    while(std::getline(in, line))
+    {
+        ++iLine;
+        const std::string where = configName + ":" + std::to_string(iLine);
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream ss(line);
+        std::string keyword;
+        if(!(ss >> keyword)) continue;
+
+        if(keyword == "board")
+        {
+            std::string name;
+            int first = 0, last = -1;
+            if(!(ss >> name)) THROW_NTREXCEPTION(where + ": board needs a name");
+            if(ss >> first && !(ss >> last)) THROW_NTREXCEPTION(where + ": board channel range needs a first and a last channel");
+            addBoard(name, first, last);
+        }
+        else if(keyword == "product")
+        {
+            ProductDef product;
+            std::string type, binning;
+            if(!(ss >> product.name >> product.branchSuffix >> type >> binning)) THROW_NTREXCEPTION(where + ": product needs a name, branch suffix, type and binning");
+
+            if     (type == "u16") product.type = ProductDef::ValueType::UShort;
+            else if(type == "f32") product.type = ProductDef::ValueType::Float;
+            else THROW_NTREXCEPTION(where + ": unknown product type \"" + type + "\"");
+
+            if(binning == "edges")
+            {
+                std::string edges, edge;
+                if(!(ss >> edges)) THROW_NTREXCEPTION(where + ": edges needs a comma separated list");
+                std::istringstream es(edges);
+                while(std::getline(es, edge, ',')) product.binEdges.push_back(parseDouble(edge, where));
+            }
+            else
+            {
+                product.nBins = parseInt(binning, where);
+                if(!(ss >> product.xMin >> product.xMax)) THROW_NTREXCEPTION(where + ": uniform binning needs nBins, xMin and xMax");
+            }
+
+            std::string option;
+            while(ss >> option)
+            {
+                if(option == "window")
+                {
+                    if(product.type == ProductDef::ValueType::Float) THROW_NTREXCEPTION(where + ": window is an ADC code window, f32 products are binned by value");
+                    int adcMin, adcMax;
+                    if(!(ss >> adcMin >> adcMax) || adcMin < 0 || adcMax >= ADCHist::nADCCodes) THROW_NTREXCEPTION(where + ": window needs a min and max ADC code");
+                    product.adcMin = adcMin;
+                    product.adcMax = adcMax;
+                }
+                else if(option == "select")
+                {
+                    if(!(ss >> product.selectBranch >> product.selectType >> product.selectValue)) THROW_NTREXCEPTION(where + ": select needs a branch, type and value");
+                }
+                else if(option == "fit")
+                {
+                    product.fit = true;
+                }
+                else
+                {
+                    THROW_NTREXCEPTION(where + ": unknown product option \"" + option + "\"");
+                }
+            }
+
+            addProduct(product);
+        }
+        else
+        {
+            THROW_NTREXCEPTION(where + ": unknown keyword \"" + keyword + "\"");
+        }
+    }
+}
+
+std::set<std::string> HistBooking::getActiveBranches() const
+{
+    std::set<std::string> branches;
+    for(unsigned int i = 0; i < boards_.size(); ++i)
+    {
+        for(unsigned int j = 0; j < products_.size(); ++j) branches.insert(getBranchName(i, j));
+    }
+    for(const auto& product : products_)
+    {
+        if(!product.selectBranch.empty()) branches.insert(product.selectBranch);
+    }
+    return branches;
+}
+
+std::vector<ADCHist> HistBooking::book() const
+{
+    std::vector<ADCHist> hists;
+    for(const auto& board : boards_)
+    {
+        //the channel count of an open range is set by the first event
+        const int nChannels = board.lastChannel < 0 ? 0 : board.lastChannel - board.firstChannel + 1;
+        for(const auto& product : products_)
+        {
+            const std::string name = board.name + "_" + product.name;
+            if(product.binEdges.empty()) hists.emplace_back(name, nChannels, product.nBins, product.xMin, product.xMax, product.adcMin, product.adcMax);
+            else                         hists.emplace_back(name, nChannels, product.binEdges, product.adcMin, product.adcMax);
+        }
+    }
+    return hists;
+}
+
+std::string HistBooking::getConfigString() const
+{
+    std::ostringstream ss;
+    ss.precision(17);
+    for(const auto& board : boards_) ss << "board " << board.name << " " << board.firstChannel << " " << board.lastChannel << "\n";
+    for(const auto& product : products_)
+    {
+        ss << "product " << product.name << " " << product.branchSuffix << " " << (product.type == ProductDef::ValueType::Float ? "f32" : "u16");
+        if(product.binEdges.empty())
+        {
+            ss << " " << product.nBins << " " << product.xMin << " " << product.xMax;
+        }
+        else
+        {
+            ss << " edges ";
+            for(unsigned int i = 0; i < product.binEdges.size(); ++i) ss << (i ? "," : "") << product.binEdges[i];
+        }
+        if(product.type == ProductDef::ValueType::UShort) ss << " window " << product.adcMin << " " << product.adcMax;
+        if(!product.selectBranch.empty()) ss << " select " << product.selectBranch << " " << product.selectType << " " << product.selectValue;
+        if(product.fit) ss << " fit";
+        ss << "\n";
+    }
+    return ss.str();
+}
+
+namespace
+{
+    template<typename T> std::function<bool()> makeSelection(const NTupleReader& tr, const std::string& branch, const double value)
+    {
+        //the reader keeps the value at a fixed address, so it is only looked up once
+        const T* var = static_cast<const T*>(tr.getPtr<T>(branch));
+        return [var, value]() { return static_cast<double>(*var) == value; };
+    }
+}
+
+HistBooking::Filler::Filler(const HistBooking& booking, const NTupleReader& tr)
+{
+    const auto& products = booking.getProducts();
+    for(const auto& product : products)
+    {
+        if(product.selectBranch.empty()) continue;
+
+        const std::string& type = product.selectType;
+        if     (type == "int")     selections_.push_back(makeSelection<int>(tr, product.selectBranch, product.selectValue));
+        else if(type == "uint")    selections_.push_back(makeSelection<unsigned int>(tr, product.selectBranch, product.selectValue));
+        else if(type == "ushort")  selections_.push_back(makeSelection<unsigned short>(tr, product.selectBranch, product.selectValue));
+        else if(type == "uchar")   selections_.push_back(makeSelection<unsigned char>(tr, product.selectBranch, product.selectValue));
+        else if(type == "long64")  selections_.push_back(makeSelection<Long64_t>(tr, product.selectBranch, product.selectValue));
+        else if(type == "ulong64") selections_.push_back(makeSelection<ULong64_t>(tr, product.selectBranch, product.selectValue));
+        else if(type == "float")   selections_.push_back(makeSelection<float>(tr, product.selectBranch, product.selectValue));
+        else if(type == "double")  selections_.push_back(makeSelection<double>(tr, product.selectBranch, product.selectValue));
+        else if(type == "bool")    selections_.push_back(makeSelection<bool>(tr, product.selectBranch, product.selectValue));
+        else THROW_NTREXCEPTION("Unknown selection type \"" + type + "\" for product \"" + product.name + "\"");
+    }
+
+    const auto& boards = booking.getBoards();
+    for(unsigned int i = 0; i < boards.size(); ++i)
+    {
+        int iSelect = 0;
+        for(unsigned int j = 0; j < products.size(); ++j)
+        {
+            const auto& product = products[j];
+            const std::string branch = booking.getBranchName(i, j);
+            const void* vecSlot = product.type == ProductDef::ValueType::Float ? tr.getVecPtr<float>(branch) : tr.getVecPtr<unsigned short>(branch);
+
+            slots_.push_back({booking.getIndex(i, j), boards[i].firstChannel, product.type, vecSlot, product.selectBranch.empty() ? -1 : iSelect});
+            if(!product.selectBranch.empty()) ++iSelect;
+        }
+    }
+}
+
+void HistBooking::Filler::fill(std::vector<ADCHist>& hists) const
+{
+    //every selection is evaluated once per event, not once per board
+    selected_.resize(selections_.size());
+    for(unsigned int i = 0; i < selections_.size(); ++i) selected_[i] = selections_[i]();
+
+    for(const auto& slot : slots_)
+    {
+        if(slot.iSelect >= 0 && !selected_[slot.iSelect]) continue;
+
+        ADCHist& hist = hists[slot.iHist];
+        if(slot.type == ProductDef::ValueType::UShort)
+        {
+            const std::vector<unsigned short>& vec = **static_cast<const std::vector<unsigned short>* const*>(slot.vecSlot);
+            if(hist.getNChannels() == 0) hist.setNChannels(std::max(0, static_cast<int>(vec.size()) - slot.firstChannel));
+
+            const int nChannels = std::min(hist.getNChannels(), static_cast<int>(vec.size()) - slot.firstChannel);
+            if(nChannels > 0) fillADCBoard(vec.data() + slot.firstChannel, nChannels, hist.getBinTable(), hist.getCounts(), hist.getStride(), hist.getDiscardBin(), hist.getADCMin(), hist.getADCMax());
+        }
+        else
+        {
+            //floating point products are binned by value, negative and fractional values included
+            const std::vector<float>& vec = **static_cast<const std::vector<float>* const*>(slot.vecSlot);
+            if(hist.getNChannels() == 0) hist.setNChannels(std::max(0, static_cast<int>(vec.size()) - slot.firstChannel));
+
+            const int nChannels = std::min(hist.getNChannels(), static_cast<int>(vec.size()) - slot.firstChannel);
+            for(int c = 0; c < nChannels; ++c) hist.fillValue(c, vec[slot.firstChannel + c]);
+        }
+    }
+}
@@ -0,0 +1,144 @@
+#include "../include/HistCheckpoint.h"
+#include "BinaryIO.h"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    const char checkpointMagic[8] = {'A', 'D', 'C', 'C', 'K', 'P', 'T', '1'};
+}
+
+using namespace BinaryIO;
+
+HistCheckpoint::HistCheckpoint(const std::string& dirName, const std::string& configString) : dirName_(dirName), configString_(configString), configHash_(hash(configString))
+{
+    struct stat buf;
+    if(stat(dirName_.c_str(), &buf) == 0)
+    {
+        if(!S_ISDIR(buf.st_mode)) THROW_NTREXCEPTION("Checkpoint path \"" + dirName_ + "\" is not a directory");
+    }
+    else if(mkdir(dirName_.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        THROW_NTREXCEPTION("Cannot create checkpoint directory \"" + dirName_ + "\": " + std::strerror(errno));
+    }
+}
+
+std::string HistCheckpoint::getCheckpointName(const std::string& fileName, const std::string& treeName) const
+{
+    std::ostringstream ss;
+    ss << dirName_ << "/" << std::hex << std::setfill('0') << std::setw(16) << configHash_ << "_" << std::setw(16) << hash(treeName + "\n" + fileName) << ".ckpt";
+    return ss.str();
+}
+
+bool HistCheckpoint::load(const std::string& fileName, const std::string& treeName, std::vector<ADCHist>& hists) const
+{
+    Long64_t fileSize, modTime;
+    if(!getFileIdentity(fileName, fileSize, modTime)) return false;
+
+    std::ifstream in(getCheckpointName(fileName, treeName), std::ios::binary);
+    if(!in) return false;
+
+    //the full keys are stored as well, a hash collision or a changed file is a cache miss
+    char magic[sizeof(checkpointMagic)];
+    uint64_t storedHash;
+    std::string storedConfig, storedFile, storedTree;
+    Long64_t storedSize, storedTime;
+    if(!in.read(magic, sizeof(magic)) || std::memcmp(magic, checkpointMagic, sizeof(magic)) != 0) return false;
+    if(!readValue(in, storedHash) || !readString(in, storedConfig) || !readString(in, storedFile) || !readString(in, storedTree)) return false;
+    if(!readValue(in, storedSize) || !readValue(in, storedTime)) return false;
+    if(storedHash != configHash_ || storedConfig != configString_ || storedFile != fileName || storedTree != treeName) return false;
+    if(storedSize != fileSize || storedTime != modTime) return false;
+
+    uint32_t nHists;
+    if(!readValue(in, nHists) || nHists != hists.size()) return false;
+
+    //read into a copy so that a truncated checkpoint leaves the booked hists alone
+    std::vector<ADCHist> cached = hists;
+    for(auto& hist : cached)
+    {
+        std::string name;
+        int32_t nChannels, stride;
+        if(!readString(in, name) || !readValue(in, nChannels) || !readValue(in, stride)) return false;
+        if(name != hist.getName() || stride != hist.getStride() || nChannels < 0) return false;
+
+        hist.setNChannels(nChannels);
+        const std::streamsize nBytes = static_cast<std::streamsize>(nChannels)*stride*sizeof(uint32_t);
+        if(nBytes > 0 && !in.read(reinterpret_cast<char*>(hist.getCounts()), nBytes)) return false;
+    }
+
+    hists.swap(cached);
+    return true;
+}
+
+void HistCheckpoint::save(const std::string& fileName, const std::string& treeName, const std::vector<ADCHist>& hists) const
+{
+    Long64_t fileSize, modTime;
+    if(!getFileIdentity(fileName, fileSize, modTime)) return;
+
+    //write to a temporary file first so that an interrupted job never leaves a truncated checkpoint;
+    //its name is per process as jobs sharing the checkpoint directory may write the same checkpoint
+    const std::string checkpointName = getCheckpointName(fileName, treeName);
+    const std::string tmpName = checkpointName + "." + std::to_string(getpid()) + ".tmp";
+    {
+        std::ofstream out(tmpName, std::ios::binary);
+        if(!out) THROW_NTREXCEPTION("Cannot write checkpoint \"" + tmpName + "\"");
+
+        out.write(checkpointMagic, sizeof(checkpointMagic));
+        writeValue(out, configHash_);
+        writeString(out, configString_);
+        writeString(out, fileName);
+        writeString(out, treeName);
+        writeValue(out, fileSize);
+        writeValue(out, modTime);
+
+        writeValue<uint32_t>(out, hists.size());
+        for(const auto& hist : hists)
+        {
+            writeString(out, hist.getName());
+            writeValue<int32_t>(out, hist.getNChannels());
+            writeValue<int32_t>(out, hist.getStride());
+            out.write(reinterpret_cast<const char*>(hist.getCounts()), static_cast<std::streamsize>(hist.getNChannels())*hist.getStride()*sizeof(uint32_t));
+        }
+
+        //the final flush can fail as well, e.g. on a full disk
+        out.close();
+        if(!out)
+        {
+            std::remove(tmpName.c_str());
+            THROW_NTREXCEPTION("Error writing checkpoint \"" + tmpName + "\"");
+        }
+    }
+
+    if(std::rename(tmpName.c_str(), checkpointName.c_str()) != 0)
+    {
+        std::remove(tmpName.c_str());
+        THROW_NTREXCEPTION("Cannot move checkpoint to \"" + checkpointName + "\"");
+    }
+}
+
+bool HistCheckpoint::getFileIdentity(const std::string& fileName, Long64_t& fileSize, Long64_t& modTime)
+{
+    struct stat buf;
+    if(fileName.empty() || stat(fileName.c_str(), &buf) != 0) return false;
+    fileSize = buf.st_size;
+    modTime = buf.st_mtime;
+    return true;
+}
+
+uint64_t HistCheckpoint::hash(const std::string& str)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for(const unsigned char c : str)
+    {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
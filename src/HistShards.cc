@@ -0,0 +1,112 @@
+#include "../include/HistShards.h"
+
+#include <thread>
+#include <exception>
+
+ADCHistShards::ADCHistShards(const std::vector<ADCHist>& boards, const int nShards)
+{
+    if(nShards < 1) THROW_NTREXCEPTION("At least one shard is needed, " + std::to_string(nShards) + " requested");
+
+    //every shard starts as an empty copy of the booked boards
+    shards_.assign(nShards, boards);
+    for(auto& shard : shards_)
+    {
+        for(auto& board : shard) board.reset();
+    }
+}
+
+void ADCHistShards::run(const std::function<void(int, std::vector<ADCHist>&)>& func)
+{
+    std::vector<std::exception_ptr> errors(shards_.size());
+    std::vector<std::thread> threads;
+    for(unsigned int i = 0; i < shards_.size(); ++i)
+    {
+        threads.emplace_back([this, &func, &errors, i]()
+        {
+            try
+            {
+                func(i, shards_[i]);
+            }
+            catch(...)
+            {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    for(auto& thread : threads) thread.join();
+
+    //report the first failure in shard order
+    for(const auto& error : errors)
+    {
+        if(error) std::rethrow_exception(error);
+    }
+}
+
+std::vector<ADCHist> ADCHistShards::merge() const
+{
+    std::vector<ADCHist> merged = shards_[0];
+    for(unsigned int i = 1; i < shards_.size(); ++i)
+    {
+        if(shards_[i].size() != merged.size()) THROW_NTREXCEPTION("Shard " + std::to_string(i) + " has a different number of boards");
+
+        addADCHists(merged, shards_[i]);
+    }
+    return merged;
+}
+
+void addADCHists(std::vector<ADCHist>& sum, const std::vector<ADCHist>& hists)
+{
+    if(hists.size() != sum.size()) THROW_NTREXCEPTION("Cannot add " + std::to_string(hists.size()) + " histograms to " + std::to_string(sum.size()));
+
+    for(unsigned int j = 0; j < sum.size(); ++j)
+    {
+        //the channel count of a set which saw no event is still unknown
+        if(hists[j].getNChannels() == 0) continue;
+        if(sum[j].getNChannels() == 0) sum[j].setNChannels(hists[j].getNChannels());
+        sum[j].add(hists[j]);
+    }
+}
+
+HistVec toHistVec(const std::vector<ADCHist>& boards)
+{
+    HistVec hVec;
+    for(const auto& board : boards)
+    {
+        hVec.push_back(std::make_pair(board.getName(), std::vector<std::shared_ptr<TH1D>>()));
+        for(int i = 0; i < board.getNChannels(); i++) hVec.back().second.push_back(board.toTH1D(i));
+    }
+    return hVec;
+}
+
+HistVec mergeHistVecs(const std::vector<HistVec>& shards)
+{
+    HistVec merged;
+    if(shards.empty()) return merged;
+
+    //start from a detached copy of the first shard
+    for(const auto& board : shards[0])
+    {
+        merged.push_back(std::make_pair(board.first, std::vector<std::shared_ptr<TH1D>>()));
+        for(const auto& h : board.second)
+        {
+            merged.back().second.push_back(std::make_shared<TH1D>(*h));
+            merged.back().second.back()->SetDirectory(nullptr);
+        }
+    }
+
+    for(unsigned int i = 1; i < shards.size(); ++i)
+    {
+        if(shards[i].size() != merged.size()) THROW_NTREXCEPTION("Shard " + std::to_string(i) + " has a different number of boards");
+
+        for(unsigned int j = 0; j < merged.size(); ++j)
+        {
+            const auto& board = shards[i][j];
+            if(board.first != merged[j].first || board.second.size() != merged[j].second.size()) 
+            {
+                THROW_NTREXCEPTION("Shard " + std::to_string(i) + " board \"" + board.first + "\" does not match \"" + merged[j].first + "\"");
+            }
+            for(unsigned int k = 0; k < board.second.size(); ++k) merged[j].second[k]->Add(board.second[k].get());
+        }
+    }
+    return merged;
+}
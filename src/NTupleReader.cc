@@ -4,6 +4,10 @@
 #include "TChain.h"
 #include "TObjArray.h"
 #include "TBranchElement.h"
+#include "TBasket.h"
+
+#include <algorithm>
+#include <numeric>
 
 NTupleReaderIterator::NTupleReaderIterator(NTupleReader& tr, int begin) : tr_(tr), current_(begin)
 {
@@ -85,7 +89,7 @@ NTupleReader::NTupleReader(TTree * tree)
     init();
 }
 
-NTupleReader::NTupleReader(NTupleReader&& tr) : tree_(tr.tree_), nevt_(tr.nevt_), evtProcessed_(tr.evtProcessed_), chainCurrentTree_(tr.chainCurrentTree_), isUpdateDisabled_(tr.isUpdateDisabled_), reThrow_(tr.reThrow_), convertHackActive_(tr.convertHackActive_), branchMap_(std::move(tr.branchMap_)), branchVecMap_(std::move(tr.branchVecMap_)), functionVec_(std::move(tr.functionVec_)), typeMap_(std::move(tr.typeMap_)), activeBranches_(std::move(tr.activeBranches_))
+NTupleReader::NTupleReader(NTupleReader&& tr) : tree_(tr.tree_), nevt_(tr.nevt_), evtProcessed_(tr.evtProcessed_), chainCurrentTree_(tr.chainCurrentTree_), isUpdateDisabled_(tr.isUpdateDisabled_), reThrow_(tr.reThrow_), convertHackActive_(tr.convertHackActive_), randomAccess_(tr.randomAccess_), basketsPerBranch_(tr.basketsPerBranch_), defaultMaxVirtualSize_(tr.defaultMaxVirtualSize_), basketCacheTreeNumber_(tr.basketCacheTreeNumber_), basketCacheBranches_(std::move(tr.basketCacheBranches_)), basketLRU_(std::move(tr.basketLRU_)), entryIndex_(std::move(tr.entryIndex_)), branchMap_(std::move(tr.branchMap_)), branchVecMap_(std::move(tr.branchVecMap_)), functionVec_(std::move(tr.functionVec_)), typeMap_(std::move(tr.typeMap_)), activeBranches_(std::move(tr.activeBranches_))
 {    
 }
 
@@ -110,6 +114,10 @@ void NTupleReader::init()
     reThrow_ = true;
     convertHackActive_ = false;
     chainCurrentTree_ = -999;
+    randomAccess_ = false;
+    basketsPerBranch_ = 0;
+    defaultMaxVirtualSize_ = 0;
+    basketCacheTreeNumber_ = -1;
 
     if(tree_)
     {
@@ -120,6 +128,8 @@ void NTupleReader::init()
 
         tree_->SetBranchStatus("*", 0);
 
+        entryIndex_.setTree(tree_);
+
         // Add desired branches to branchMap_/branchVecMap_
         populateBranchList();
     }
@@ -131,6 +141,8 @@ void NTupleReader::setTree(TTree * tree)
     {
         tree_ = tree;
         tree_->SetBranchStatus("*", 0);
+
+        entryIndex_.setTree(tree_);
         
         // Add desired branches to branchMap_/branchVecMap_
         populateBranchList();
@@ -150,7 +162,40 @@ int NTupleReader::getNEntries() const
 {
     try
     {
-        if(tree_) return tree_->GetEntries();
+        if(tree_) 
+        {
+            //Once every file was counted there is no need to let the TChain open them all
+            bool exact = false;
+            if(entryIndex_.isExact()) return entryIndex_.getNEntries(exact);
+
+            int nEntries = tree_->GetEntries();
+            entryIndex_.update();
+            return nEntries;
+        }
+        else 
+        {
+            THROW_NTREXCEPTION("NO tree defined yet!!!");
+        }
+    }
+    catch(const NTRException& e)
+    {
+        e.print();
+        if(reThrow_) throw;
+        return -1;
+    }
+}
+
+Long64_t NTupleReader::getNEntries(bool& exact) const
+{
+    try
+    {
+        if(tree_) 
+        {
+            entryIndex_.update();
+            //Without any counted file the estimate would be meaningless, count the first one
+            if(entryIndex_.getNFiles() > 0 && entryIndex_.getNExactFiles() == 0) entryIndex_.resolve(0);
+            return entryIndex_.getNEntries(exact);
+        }
         else 
         {
             THROW_NTREXCEPTION("NO tree defined yet!!!");
@@ -160,6 +205,7 @@ int NTupleReader::getNEntries() const
     {
         e.print();
         if(reThrow_) throw;
+        exact = false;
         return -1;
     }
 }
@@ -359,6 +405,8 @@ void NTupleReader::createVectorsForArrayReads(int evt)
         if(chainCurrentTree_ != treeNum)
         {
             chainCurrentTree_ = treeNum;
+            //the count of a file is exact as soon as the chain has it open
+            if(treeNum >= 0 && treeNum < entryIndex_.getNFiles() && tree_->GetTree()) entryIndex_.setNEntries(treeNum, tree_->GetTree()->GetEntries());
             //update branch references 
             updateBranches = true;
         }
@@ -416,6 +464,8 @@ bool NTupleReader::goToEventInternal(int evt, const bool filter)
         }
         nevt_ = evt + 1;
         ++evtProcessed_;
+        //Keep track of the baskets which were just decompressed
+        if(randomAccess_) updateBasketCache();
         //Calculate extra derived variables 
         passFilters = calculateDerivedVariables();
     }
@@ -428,6 +478,123 @@ bool NTupleReader::getNextEvent()
     return goToEventInternal(nevt_, true);
 }
 
+void NTupleReader::setRandomAccess(const bool randomAccess, const int basketsPerBranch)
+{
+    if(!tree_) THROW_NTREXCEPTION("NO tree defined yet!!!");
+    if(randomAccess && basketsPerBranch < 1) THROW_NTREXCEPTION("Random access mode needs at least one basket per branch, " + std::to_string(basketsPerBranch) + " requested");
+
+    if(randomAccess && !randomAccess_) defaultMaxVirtualSize_ = tree_->GetMaxVirtualSize();
+
+    //release all cached baskets before the cache is resized or switched off
+    resetBasketCache();
+
+    randomAccess_ = randomAccess;
+    basketsPerBranch_ = randomAccess ? basketsPerBranch : 0;
+
+    if(!randomAccess_)
+    {
+        tree_->SetMaxVirtualSize(defaultMaxVirtualSize_);
+        if(tree_->GetTree()) tree_->GetTree()->SetMaxVirtualSize(defaultMaxVirtualSize_);
+    }
+}
+
+std::vector<unsigned int> NTupleReader::sortByBasket(const std::vector<int>& evts) const
+{
+    //Baskets hold contiguous entry ranges and the entries of a TChain are ordered by file, so 
+    //sorting by entry number groups the requests by basket for every branch at the same time 
+    std::vector<unsigned int> order(evts.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&evts](const unsigned int a, const unsigned int b) { return evts[a] < evts[b]; });
+    return order;
+}
+
+void NTupleReader::resetBasketCache()
+{
+    //drop every basket still held for the current tree (if it is still loaded)
+    if(basketCacheTreeNumber_ >= 0 && basketCacheTreeNumber_ == tree_->GetTreeNumber())
+    {
+        for(auto& lru : basketLRU_)
+        {
+            for(const int iBasket : lru.second) dropBasket(lru.first, iBasket);
+        }
+    }
+
+    basketCacheTreeNumber_ = -1;
+    basketCacheBranches_.clear();
+    basketLRU_.clear();
+}
+
+void NTupleReader::updateBasketCache()
+{
+    //For a TChain this is the tree of the file currently loaded
+    TTree* tree = tree_->GetTree();
+    if(!tree) return;
+
+    //New file in the chain (or first call), the baskets of the old file are gone with its tree
+    if(tree_->GetTreeNumber() != basketCacheTreeNumber_)
+    {
+        basketCacheTreeNumber_ = -1;
+        resetBasketCache();
+        basketCacheTreeNumber_ = tree_->GetTreeNumber();
+
+        Long64_t maxVirtualSize = 0;
+        TObjArray *lob = tree->GetListOfBranches();
+        TIter next(lob);
+        TBranch *branch;
+        while((branch = (TBranch*)next()))
+        {
+            if(branch->TestBit(TBranch::kDoNotProcess)) continue;
+            basketCacheBranches_.push_back(branch);
+            maxVirtualSize += Long64_t(basketsPerBranch_ + 1)*branch->GetBasketSize();
+        }
+
+        //ROOT keeps at most one basket per branch unless it is allowed more memory, the LRU below 
+        //keeps the real bound so this is only a safety margin for oversized baskets
+        tree->SetMaxVirtualSize(2*maxVirtualSize);
+    }
+
+    for(auto* branch : basketCacheBranches_)
+    {
+        const int iBasket = branch->GetReadBasket();
+        auto& lru = basketLRU_[branch];
+
+        //move the basket just used to the front of the list
+        auto iter = std::find(lru.begin(), lru.end(), iBasket);
+        if(iter == lru.begin() && iter != lru.end()) continue;
+        if(iter != lru.end()) lru.erase(iter);
+        lru.push_front(iBasket);
+
+        //evict the least recently used baskets 
+        while(static_cast<int>(lru.size()) > basketsPerBranch_)
+        {
+            dropBasket(branch, lru.back());
+            lru.pop_back();
+        }
+    }
+}
+
+void NTupleReader::dropBasket(TBranch * const branch, const int iBasket)
+{
+    //TBranch::DropBaskets only drops all baskets but the current one at once, which is what 
+    //ROOT does anyway when the tree's memory is full, so single baskets are removed here the way 
+    //it removes them: TBasket::DropBuffers returns the buffer to the tree's memory accounting and 
+    //an empty slot in the basket list makes the branch read the basket from the file again.  
+    //Only the branch's count of baskets in memory is not decremented, which merely makes a later 
+    //DropBaskets look at every slot.  The basket the branch is currently reading from (its 
+    //current basket) is never dropped.
+    if(iBasket == branch->GetReadBasket()) return;
+
+    TObjArray* baskets = branch->GetListOfBaskets();
+    if(iBasket < 0 || iBasket > baskets->GetLast()) return;
+
+    TBasket* basket = static_cast<TBasket*>(baskets->RemoveAt(iBasket));
+    if(basket)
+    {
+        basket->DropBuffers();
+        delete basket;
+    }
+}
+
 void NTupleReader::disableUpdate()
 {
     isUpdateDisabled_ = true;
@@ -0,0 +1,86 @@
+#include "../include/ProcessPool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <exception>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+ProcessPool::ProcessPool(const int nProcesses) : nProcesses_(nProcesses)
+{
+    if(nProcesses < 1) THROW_NTREXCEPTION("At least one process is needed, " + std::to_string(nProcesses) + " requested");
+}
+
+void ProcessPool::run(const int nTasks, const std::function<void(int)>& task)
+{
+    //output still buffered in the parent would otherwise be written by every child as well
+    fflush(stdout);
+    fflush(stderr);
+
+    const int nWorkers = std::min(nProcesses_, nTasks);
+    std::vector<pid_t> children;
+    std::string forkError;
+    for(int iWorker = 0; iWorker < nWorkers; ++iWorker)
+    {
+        const pid_t pid = fork();
+        if(pid < 0)
+        {
+            forkError = strerror(errno);
+            break;
+        }
+        if(pid == 0)
+        {
+            //the number of failed tasks is the exit status
+            int nFailed = 0;
+            for(int iTask = iWorker; iTask < nTasks; iTask += nWorkers)
+            {
+                try
+                {
+                    task(iTask);
+                }
+                catch(const NTRException& e)
+                {
+                    e.print();
+                    ++nFailed;
+                }
+                catch(const std::exception& e)
+                {
+                    fprintf(stderr, "Task %d failed: %s\n", iTask, e.what());
+                    ++nFailed;
+                }
+                catch(...)
+                {
+                    fprintf(stderr, "Task %d failed\n", iTask);
+                    ++nFailed;
+                }
+            }
+            fflush(stdout);
+            fflush(stderr);
+            _exit(std::min(nFailed, 255));
+        }
+        children.push_back(pid);
+    }
+
+    //wait for the children which did start, even if not all of them could
+    int nFailed = 0;
+    int nCrashed = 0;
+    for(const pid_t pid : children)
+    {
+        int status = 0;
+        while(waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+        if(WIFEXITED(status)) nFailed += WEXITSTATUS(status);
+        else ++nCrashed;
+    }
+
+    if(!forkError.empty()) THROW_NTREXCEPTION("Could not fork worker " + std::to_string(children.size()) + ": " + forkError);
+    if(nFailed || nCrashed)
+    {
+        THROW_NTREXCEPTION(std::to_string(nFailed) + " of " + std::to_string(nTasks) + " tasks failed, " + std::to_string(nCrashed) + " of " +
+                           std::to_string(children.size()) + " workers crashed");
+    }
+}
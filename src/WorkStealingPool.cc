@@ -0,0 +1,93 @@
+#include "../include/WorkStealingPool.h"
+
+#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+WorkStealingPool::WorkStealingPool(const int nThreads) : nThreads_(nThreads), nStolen_(0)
+{
+    if(nThreads < 1) THROW_NTREXCEPTION("At least one thread is needed, " + std::to_string(nThreads) + " requested");
+
+    for(int i = 0; i < nThreads_; ++i) queues_.emplace_back(new TaskQueue);
+}
+
+void WorkStealingPool::run(const int nTasks, const std::function<void(int)>& task)
+{
+    for(int i = 0; i < nTasks; ++i) queues_[i % nThreads_]->tasks.push_back(i);
+
+    std::vector<std::exception_ptr> errors(nTasks);
+    std::atomic<int> nStolen(0);
+    auto work = [&](const int iWorker)
+    {
+        int iTask;
+        bool stolen;
+        while(next(iWorker, iTask, stolen))
+        {
+            if(stolen) ++nStolen;
+            try
+            {
+                task(iTask);
+            }
+            catch(...)
+            {
+                errors[iTask] = std::current_exception();
+            }
+        }
+    };
+
+    //the calling thread is worker 0
+    std::vector<std::thread> threads;
+    for(int i = 1; i < std::min(nThreads_, nTasks); ++i) threads.emplace_back(work, i);
+    work(0);
+    for(auto& thread : threads) thread.join();
+    nStolen_ = nStolen;
+
+    //report the first failure in task order
+    for(const auto& error : errors)
+    {
+        if(error) std::rethrow_exception(error);
+    }
+}
+
+bool WorkStealingPool::next(const int iWorker, int& iTask, bool& stolen)
+{
+    {
+        TaskQueue& own = *queues_[iWorker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if(!own.tasks.empty())
+        {
+            iTask = own.tasks.front();
+            own.tasks.pop_front();
+            stolen = false;
+            return true;
+        }
+    }
+
+    //steal from the back of the fullest deque; tasks are only ever removed, so when every
+    //deque is seen empty the run is over for this worker
+    while(true)
+    {
+        int victim = -1;
+        size_t most = 0;
+        for(int i = 0; i < nThreads_; ++i)
+        {
+            if(i == iWorker) continue;
+            std::lock_guard<std::mutex> lock(queues_[i]->mutex);
+            if(queues_[i]->tasks.size() > most)
+            {
+                most = queues_[i]->tasks.size();
+                victim = i;
+            }
+        }
+        if(victim < 0) return false;
+
+        std::lock_guard<std::mutex> lock(queues_[victim]->mutex);
+        //another thief may have been faster
+        if(queues_[victim]->tasks.empty()) continue;
+        iTask = queues_[victim]->tasks.back();
+        queues_[victim]->tasks.pop_back();
+        stolen = true;
+        return true;
+    }
+}
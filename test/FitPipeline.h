@@ -0,0 +1,484 @@
+#ifndef FitPipeline_h
+#define FitPipeline_h
+
+#include "SPEfunc.h"
+#include "PoissonNLL.h"
+#include "LaneFit.h"
+#include "Minuit2/MnUserParameters.h"
+#include "Minuit2/MnMigrad.h"
+#include "Minuit2/FunctionMinimum.h"
+#include "../include/NTRException.h"
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <utility>
+
+//Staged binned likelihood fits of PPEFunc models described as data
+//
+//Every stage lists one ParRule per model parameter: fixed or free, started from a value of its
+//own, from the result of the previous stage or from the seed of the run, and bounded by absolute
+//limits, by factors of the start value or by a number of widths (another parameter) around it.
+//The fit range edges are values or previous or seed results as well.  All stages of one
+//histogram share a FitContext, i.e. one model per peak count/MIP configuration (so the crosstalk
+//coefficients and the MIP grid carry over) and the bin edges and contents, copied out of the
+//histogram once and handed to the likelihood of every stage.
+//
+//A stage without free parameters is skipped.  A stage marked skipIfConverged is skipped when the
+//estimated distance to the minimum at its start values, 0.5 sum_i (dNLL/dp_i err_i)^2 over the
+//free parameters with the errors of the previous stages, is below the pipeline tolerance.
+//
+//A run can be seeded with the result of an earlier fit or with an estimate from the spectrum.
+//The seed serves as the previous stage of the first one, and any stage can take start values,
+//limits and range edges from it; this is how fits are warm started from stored parameters and
+//started from estimated ones.
+//
+//runLanes fits the stages of several channels together, see LaneFit; the results are those of
+//run() up to the minimizer.
+
+//How one parameter enters a stage
+struct ParRule
+{
+  enum Start { Value, Previous, Seed };
+  enum Limits { Unbounded, Absolute, Relative, Around };
+
+  bool fixed;
+  Start start;
+  double value;
+  Limits limits;
+  double low, up;
+  int widthPar;
+
+  static ParRule fix(double v)      { return {true,  Value,    v, Unbounded, 0, 0, -1}; }
+  static ParRule fixPrevious()      { return {true,  Previous, 0, Unbounded, 0, 0, -1}; }
+  static ParRule fixSeed()          { return {true,  Seed,     0, Unbounded, 0, 0, -1}; }
+  static ParRule free(double v)     { return {false, Value,    v, Unbounded, 0, 0, -1}; }
+  static ParRule freePrevious()     { return {false, Previous, 0, Unbounded, 0, 0, -1}; }
+  static ParRule freeSeed()         { return {false, Seed,     0, Unbounded, 0, 0, -1}; }
+
+  //limits [lo, hi]
+  ParRule within(double lo, double hi) const { ParRule r = *this; r.limits = Absolute; r.low = lo; r.up = hi; return r; }
+  //limits [lo, hi] times the start value
+  ParRule scaled(double lo, double hi) const { ParRule r = *this; r.limits = Relative; r.low = lo; r.up = hi; return r; }
+  //limits start -+ n times parameter iPar, taken from where the start value comes from
+  ParRule around(double n, int iPar) const   { ParRule r = *this; r.limits = Around; r.low = -n; r.up = n; r.widthPar = iPar; return r; }
+};
+
+//Fit range edge, a value or the previous or seed result of a parameter plus an offset, and plus
+//factor times another parameter of the same result
+struct RangeEdge
+{
+  double value;
+  int par;
+  bool seed;
+  double factor;
+  int widthPar;
+
+  static RangeEdge at(double x)                                 { return {x, -1, false, 0, -1}; }
+  static RangeEdge atPrevious(int iPar, double offset = 0)      { return {offset, iPar, false, 0, -1}; }
+  static RangeEdge atSeed(int iPar, double offset = 0)          { return {offset, iPar, true, 0, -1}; }
+
+  RangeEdge plus(double f, int iPar) const { RangeEdge r = *this; r.factor = f; r.widthPar = iPar; return r; }
+};
+
+struct FitStage
+{
+  std::string name;
+  int nPeaks;
+  bool mip;
+  RangeEdge xMin, xMax;
+  std::vector<ParRule> par;
+  bool skipIfConverged;
+};
+
+struct StageResult
+{
+  std::string name;
+  std::vector<double> par, err;
+  //covariance of par, par.size() x par.size() and row major; parameters which are not fitted keep
+  //it from where they start like their errors (only the variance, err^2, if started from a value)
+  std::vector<double> cov;
+  double xMin, xMax;
+  //Poisson deviance 2 sum(mu - n + n ln(n/mu)) over the range at par, the chi^2 of a likelihood fit
+  double chi2;
+  int status;
+  bool skipped;
+  //free parameters which ended within 1e-3 of the width of their limits from one of them, and a
+  //flag per parameter for which (empty if the stage was not fitted)
+  int nAtLimit;
+  std::vector<char> atLimit;
+
+  //Telemetry: wall time of the stage (a lane fit shared evenly between its channels), model
+  //evaluations over the range (one per likelihood, with or without gradient), the estimated
+  //distance to the minimum and the covariance quality as Minuit2 reports it (-1 not computed,
+  //0 not positive definite, 1 approximate, 2 forced positive definite, 3 accurate; a lane fit
+  //reports 3 for a positive definite information matrix)
+  double seconds;
+  int nEval;
+  double edm;
+  int covQual;
+};
+
+//Histogram and models shared by the stages of one pipeline run
+class FitContext
+{
+public:
+  FitContext(TH1* h) : h_(h)
+  {
+    for(int i = 1; i <= h->GetNbinsX(); i++)
+    {
+      x_.push_back(h->GetBinCenter(i));
+      edges_.push_back(h->GetXaxis()->GetBinLowEdge(i));
+      counts_.push_back(h->GetBinContent(i));
+    }
+    edges_.push_back(h->GetXaxis()->GetBinUpEdge(h->GetNbinsX()));
+  }
+
+  TH1* getHist() const { return h_; }
+  const std::vector<double>& getEdges() const { return edges_; }
+  const std::vector<double>& getCounts() const { return counts_; }
+
+  //Model for a peak count and MIP setting, made on first use and evaluated bin-integrated
+  std::shared_ptr<PPEFunc> getModel(int nPeaks, bool mip)
+  {
+    std::shared_ptr<PPEFunc>& model = models_[std::make_pair(nPeaks, mip)];
+    if(!model)
+    {
+      model = std::make_shared<PPEFunc>(nPeaks, mip);
+      model->h = h_;
+      model->setBinEdges(h_);
+    }
+    return model;
+  }
+
+  //Bins with their centre in [xMin, xMax], empty ones included as for likelihood fits
+  int countBins(double xMin, double xMax) const
+  {
+    int n = 0;
+    for(double x : x_) n += x >= xMin && x <= xMax;
+    return n;
+  }
+
+private:
+  TH1* h_;
+  std::vector<double> x_, edges_, counts_;
+  std::map<std::pair<int, bool>, std::shared_ptr<PPEFunc>> models_;
+};
+
+class FitPipeline
+{
+public:
+  FitPipeline(const std::vector<FitStage>& stages, double edmTolerance = 1e-4) : stages_(stages), edmTolerance_(edmTolerance) {}
+
+  const std::vector<FitStage>& getStages() const { return stages_; }
+
+  //Run all stages in order, one result per stage; seed is the previous result of the first stage
+  std::vector<StageResult> run(FitContext& context, const StageResult* seed = nullptr) const
+  {
+    std::vector<StageResult> results;
+    for(const FitStage& stage : stages_)
+    {
+      results.push_back(runStage(context, stage, results.empty() ? seed : &results.back(), seed));
+    }
+    return results;
+  }
+
+  //run() for several channels with the same binning, NLanes channels fitted in lock step by
+  //LaneFit and the channels it does not converge for by Minuit; seeds may be empty
+  template<int NLanes> std::vector<std::vector<StageResult>> runLanes(const std::vector<FitContext*>& contexts, const std::vector<const StageResult*>& seeds = {}) const
+  {
+    const int nChannels = contexts.size();
+    std::vector<std::vector<StageResult>> results(nChannels);
+    for(const FitStage& stage : stages_)
+    {
+      std::vector<StagePlan> plans;
+      std::vector<int> toFit;
+      for(int c = 0; c < nChannels; c++)
+      {
+        const auto start = std::chrono::steady_clock::now();
+        const StageResult* seed = seeds.empty() ? nullptr : seeds[c];
+        plans.push_back(prepareStage(*contexts[c], stage, results[c].empty() ? seed : &results[c].back(), seed));
+        if(plans[c].fit) toFit.push_back(c);
+        plans[c].result.seconds = secondsSince(start);
+      }
+
+      std::vector<int> freePars;
+      for(unsigned int i = 0; i < stage.par.size(); i++)
+      {
+        if(!stage.par[i].fixed) freePars.push_back(i);
+      }
+
+      //consecutive channels with identical bin edges form a group
+      for(unsigned int begin = 0; begin < toFit.size(); )
+      {
+        const std::vector<double>& edges = contexts[toFit[begin]]->getEdges();
+        unsigned int end = begin + 1;
+        while(end < toFit.size() && end - begin < NLanes && contexts[toFit[end]]->getEdges() == edges) ++end;
+
+        std::vector<typename LaneFit<NLanes>::Lane> lanes(end - begin);
+        std::vector<typename LaneFit<NLanes>::Lane*> lanePtrs;
+        for(unsigned int j = begin; j < end; j++)
+        {
+          const StagePlan& plan = plans[toFit[j]];
+          typename LaneFit<NLanes>::Lane& lane = lanes[j - begin];
+          lane.model = plan.model;
+          lane.counts = contexts[toFit[j]]->getCounts().data();
+          lane.xMin = plan.result.xMin;
+          lane.xMax = plan.result.xMax;
+          lane.par = plan.result.par;
+          lane.low = plan.low;
+          lane.up = plan.up;
+          lanePtrs.push_back(&lane);
+        }
+        const auto start = std::chrono::steady_clock::now();
+        LaneFit<NLanes>(edges, freePars).fit(lanePtrs);
+        const double laneSeconds = secondsSince(start)/(end - begin);
+
+        for(unsigned int j = begin; j < end; j++)
+        {
+          StagePlan& plan = plans[toFit[j]];
+          const typename LaneFit<NLanes>::Lane& lane = lanes[j - begin];
+          const auto finish = std::chrono::steady_clock::now();
+          if(!lane.converged) minuitStage(plan, stage, lane.nEval);
+          else
+          {
+            plan.result.par = lane.par;
+            for(int i : freePars) plan.result.err[i] = lane.err[i];
+            fittedCovariance(plan.result, stage, lane.cov);
+            plan.result.status = 0;
+            plan.result.edm = lane.edm;
+            plan.result.covQual = lane.posDef ? 3 : 0;
+            finishStage(plan, stage, lane.nEval);
+          }
+          plan.result.seconds += laneSeconds + secondsSince(finish);
+        }
+        begin = end;
+      }
+
+      for(int c = 0; c < nChannels; c++) results[c].push_back(plans[c].result);
+    }
+    return results;
+  }
+
+private:
+  std::vector<FitStage> stages_;
+  double edmTolerance_;
+
+  //Status codes of the Minuit2 minimizer of ROOT::Fit::Fitter
+  static int minimumStatus(const ROOT::Minuit2::FunctionMinimum& minimum)
+  {
+    if(minimum.IsValid()) return minimum.HasMadePosDefCovar() ? 1 : 0;
+    if(minimum.HasReachedCallLimit()) return 4;
+    if(minimum.IsAboveMaxEdm()) return 3;
+    return 5;
+  }
+
+  static double secondsSince(const std::chrono::steady_clock::time_point& start)
+  {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  static double sourceValue(const StageResult* source, bool seed, int iPar, const std::string& stage)
+  {
+    if(!source || iPar >= static_cast<int>(source->par.size()))
+    {
+      THROW_NTREXCEPTION("Fit stage \"" + stage + "\" uses parameter " + std::to_string(iPar) + (seed ? " of a seed" : " of a previous stage") + " which does not have it");
+    }
+    return source->par[iPar];
+  }
+
+  static double edgeValue(const RangeEdge& edge, const StageResult* previous, const StageResult* seed, const std::string& stage)
+  {
+    if(edge.par < 0) return edge.value;
+    const StageResult* source = edge.seed ? seed : previous;
+    double x = edge.value + sourceValue(source, edge.seed, edge.par, stage);
+    if(edge.widthPar >= 0) x += edge.factor*sourceValue(source, edge.seed, edge.widthPar, stage);
+    return x;
+  }
+
+  //A stage of one channel with its start values, limits and likelihood resolved
+  struct StagePlan
+  {
+    StageResult result;
+    std::shared_ptr<PPEFunc> model;
+    std::shared_ptr<PoissonNLL> nll;
+    std::vector<double> low, up;
+    //false if the stage is skipped
+    bool fit;
+  };
+
+  StagePlan prepareStage(FitContext& context, const FitStage& stage, const StageResult* previous, const StageResult* seed) const
+  {
+    StagePlan plan;
+    plan.model = context.getModel(stage.nPeaks, stage.mip);
+    const int nPar = stage.par.size();
+    if(nPar != plan.model->getNPar())
+    {
+      THROW_NTREXCEPTION("Fit stage \"" + stage.name + "\" has " + std::to_string(nPar) + " parameter rules for a model with " + std::to_string(plan.model->getNPar()));
+    }
+
+    StageResult& result = plan.result;
+    result.name = stage.name;
+    result.xMin = edgeValue(stage.xMin, previous, seed, stage.name);
+    result.xMax = edgeValue(stage.xMax, previous, seed, stage.name);
+    result.status = 0;
+    result.skipped = false;
+    result.nAtLimit = 0;
+    result.seconds = 0;
+    result.nEval = 0;
+    result.edm = 0;
+    result.covQual = -1;
+
+    //start values, and the errors known for them
+    plan.low.assign(nPar, 0.0);
+    plan.up.assign(nPar, 0.0);
+    std::vector<const StageResult*> sources(nPar, nullptr);
+    int nFree = 0;
+    for(int i = 0; i < nPar; i++)
+    {
+      const ParRule& rule = stage.par[i];
+      const bool fromSeed = rule.start == ParRule::Seed;
+      const StageResult* source = fromSeed ? seed : previous;
+      if(rule.start != ParRule::Value) sources[i] = source;
+      const double start = rule.start == ParRule::Value ? rule.value : sourceValue(source, fromSeed, i, stage.name);
+      result.par.push_back(start);
+      result.err.push_back(rule.start == ParRule::Value || i >= static_cast<int>(source->err.size()) ? 0.0 : source->err[i]);
+      if(rule.limits == ParRule::Absolute)
+      {
+        plan.low[i] = rule.low;
+        plan.up[i] = rule.up;
+      }
+      if(rule.limits == ParRule::Relative)
+      {
+        plan.low[i] = std::min(rule.low*start, rule.up*start);
+        plan.up[i] = std::max(rule.low*start, rule.up*start);
+      }
+      if(rule.limits == ParRule::Around)
+      {
+        const double w = std::fabs(rule.start == ParRule::Value ? 0.0 : sourceValue(source, fromSeed, rule.widthPar, stage.name));
+        plan.low[i] = start + rule.low*w;
+        plan.up[i] = start + rule.up*w;
+      }
+      if(!rule.fixed) ++nFree;
+    }
+    result.cov.assign(nPar*nPar, 0.0);
+    for(int i = 0; i < nPar; i++)
+    {
+      result.cov[i*nPar + i] = result.err[i]*result.err[i];
+      for(int j = 0; j < nPar; j++)
+      {
+        const StageResult* source = sources[i];
+        if(j == i || !source || sources[j] != source) continue;
+        const int nSource = source->par.size();
+        if(i < nSource && j < nSource && static_cast<int>(source->cov.size()) == nSource*nSource) result.cov[i*nPar + j] = source->cov[i*nSource + j];
+      }
+    }
+
+    plan.nll = std::make_shared<PoissonNLL>(plan.model, context.getEdges(), context.getCounts(), result.xMin, result.xMax);
+    std::vector<double> grad(nPar);
+    result.chi2 = 2*plan.nll->value(result.par.data(), stage.skipIfConverged ? grad.data() : nullptr);
+    result.nEval = plan.nll->getNEval();
+    plan.fit = false;
+    result.skipped = true;
+    if(nFree == 0 || plan.nll->getNBins() == 0) return plan;
+    if(stage.skipIfConverged && previous && previous->status == 0)
+    {
+      double edm = 0;
+      bool known = true;
+      for(int i = 0; i < nPar; i++)
+      {
+        if(stage.par[i].fixed) continue;
+        if(!(result.err[i] > 0)) known = false;
+        edm += 0.5*grad[i]*grad[i]*result.err[i]*result.err[i];
+      }
+      if(known && edm < edmTolerance_) return plan;
+    }
+    plan.fit = true;
+    result.skipped = false;
+    return plan;
+  }
+
+  //Migrad on the likelihood of a prepared stage directly, with the settings ROOT::Fit::Fitter uses
+  //for Minuit2, after nEvalBefore model evaluations elsewhere (a lane fit which did not converge)
+  void minuitStage(StagePlan& plan, const FitStage& stage, const int nEvalBefore = 0) const
+  {
+    StageResult& result = plan.result;
+    const int nPar = result.par.size();
+    ROOT::Minuit2::MnUserParameters upar;
+    for(int i = 0; i < nPar; i++)
+    {
+      const double value = result.par[i];
+      upar.Add("p" + std::to_string(i), value, result.err[i] > 0 ? result.err[i] : (value != 0 ? 0.3*std::fabs(value) : 0.1));
+      if(stage.par[i].fixed) upar.Fix(i);
+      else if(plan.low[i] < plan.up[i]) upar.SetLimits(i, plan.low[i], plan.up[i]);
+    }
+
+    ROOT::Minuit2::MnMigrad migrad(*plan.nll, upar);
+    const ROOT::Minuit2::FunctionMinimum minimum = migrad(0, 0.01);
+    result.status = minimumStatus(minimum);
+    result.edm = minimum.Edm();
+    result.covQual = minimum.UserState().CovarianceStatus();
+    const ROOT::Minuit2::MnUserParameterState& state = minimum.UserState();
+    for(int i = 0; i < nPar; i++)
+    {
+      result.par[i] = state.Value(i);
+      //fixed parameters keep the errors they were started with
+      if(!stage.par[i].fixed) result.err[i] = state.Error(i);
+    }
+    std::vector<double> cov(nPar*nPar, 0.0);
+    for(int i = 0; i < nPar; i++)
+    {
+      for(int j = 0; j < nPar; j++)
+      {
+        if(stage.par[i].fixed || stage.par[j].fixed) continue;
+        if(state.HasCovariance()) cov[i*nPar + j] = state.Covariance()(state.IntOfExt(i), state.IntOfExt(j));
+        else if(i == j) cov[i*nPar + j] = result.err[i]*result.err[i];
+      }
+    }
+    fittedCovariance(result, stage, cov);
+    finishStage(plan, stage, nEvalBefore);
+  }
+
+  //Covariance of a fitted stage: the rows and columns of the free parameters from cov (nPar x nPar),
+  //the block of the fixed ones as started
+  static void fittedCovariance(StageResult& result, const FitStage& stage, const std::vector<double>& cov)
+  {
+    const int nPar = result.par.size();
+    for(int i = 0; i < nPar; i++)
+    {
+      for(int j = 0; j < nPar; j++)
+      {
+        if(!stage.par[i].fixed || !stage.par[j].fixed) result.cov[i*nPar + j] = cov[i*nPar + j];
+      }
+    }
+  }
+
+  //Parameters at their limits and the deviance of a fitted stage
+  static void finishStage(StagePlan& plan, const FitStage& stage, const int nEvalBefore = 0)
+  {
+    StageResult& result = plan.result;
+    result.nAtLimit = 0;
+    result.atLimit.assign(result.par.size(), 0);
+    for(unsigned int i = 0; i < result.par.size(); i++)
+    {
+      const double margin = 1e-3*(plan.up[i] - plan.low[i]);
+      result.atLimit[i] = !stage.par[i].fixed && plan.low[i] < plan.up[i] && (result.par[i] < plan.low[i] + margin || result.par[i] > plan.up[i] - margin);
+      result.nAtLimit += result.atLimit[i];
+    }
+    result.chi2 = 2*plan.nll->value(result.par.data());
+    result.nEval = nEvalBefore + plan.nll->getNEval();
+  }
+
+  StageResult runStage(FitContext& context, const FitStage& stage, const StageResult* previous, const StageResult* seed) const
+  {
+    const auto start = std::chrono::steady_clock::now();
+    StagePlan plan = prepareStage(context, stage, previous, seed);
+    if(plan.fit) minuitStage(plan, stage);
+    plan.result.seconds = secondsSince(start);
+    return plan.result;
+  }
+};
+
+#endif
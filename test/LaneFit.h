@@ -0,0 +1,424 @@
+#ifndef LaneFit_h
+#define LaneFit_h
+
+#include "SPEfunc.h"
+#include <memory>
+#include <vector>
+
+//Binned Poisson likelihood fits of up to NLanes channels in lock step, one channel per lane
+//
+//The channels share the bin edges (all channels of a booked product do) and which parameters are
+//free, but not the counts, start values, limits or fit range.  Every iteration is a damped Newton
+//(Levenberg-Marquardt) step with the expected information sum dmu dmu^T/mu as the Hessian.  The
+//model and its derivatives are evaluated per lane through PPEFunc::binGradient (the MIP
+//convolution and Landau table lookups do not map onto lanes), everything after that, the
+//likelihood, gradient and information sums over the bins and the Cholesky solves, works on
+//arrays indexed by the lane last, in fixed length loops the compiler vectorizes.
+//
+//Parameters are kept within their limits by clamping the steps; a parameter at a limit that the
+//gradient pushes outwards is held for the step, as is one the likelihood does not depend on (the
+//background width once its amplitude is at 0), which gets no error.  A lane has converged when the expected distance
+//to the minimum 0.5 g^T H^-1 g is below the tolerance.  Lanes with a singular information matrix,
+//a likelihood which does not decrease for any damping, or too many iterations are reported as not
+//converged and are meant to be refitted with Minuit.
+
+template<int NLanes> class LaneFit
+{
+public:
+  static const int maxPar = 14;
+
+  struct Lane
+  {
+    std::shared_ptr<PPEFunc> model;
+    //one count per bin of the shared edges
+    const double* counts;
+    //bins with their centre in [xMin, xMax]
+    double xMin, xMax;
+    //start values in, results out; limits low < up, unbounded otherwise
+    std::vector<double> par, low, up;
+
+    //errors of the free parameters (0 for the others), their covariance (nPar x nPar, row major, 0
+    //for the others), likelihood sum(mu - n + n ln(n/mu)) and iterations
+    std::vector<double> err, cov;
+    double nll;
+    int nIter;
+    bool converged;
+    //expected distance to the minimum at the last iteration, passes of the model over the bins
+    //(with or without derivatives) and whether the information matrix was positive definite
+    double edm;
+    int nEval;
+    bool posDef;
+  };
+
+  LaneFit(const std::vector<double>& edges, const std::vector<int>& freePars, const double edmTolerance = 1e-5, const int maxIter = 200)
+    : edges_(edges), free_(freePars), edmTolerance_(edmTolerance), maxIter_(maxIter) {}
+
+  //Fit lanes.size() <= NLanes channels
+  void fit(const std::vector<Lane*>& lanes) const
+  {
+    const int nUsed = lanes.size();
+    const int nFree = free_.size();
+    const int nBins = edges_.size() - 1;
+    //per lane parameters (for the model calls) and bin range
+    double p[NLanes][maxPar], trial[NLanes][maxPar], low[NLanes][maxPar], up[NLanes][maxPar];
+    int first[NLanes], last[NLanes];
+    bool active[NLanes];
+    int firstBin = nBins, lastBin = 0;
+    for(int l = 0; l < NLanes; l++)
+    {
+      active[l] = l < nUsed;
+      first[l] = last[l] = 0;
+      if(!active[l]) continue;
+      const Lane& lane = *lanes[l];
+      const int nPar = lane.model->getNPar();
+      for(int k = 0; k < nPar; k++)
+      {
+        p[l][k] = trial[l][k] = lane.par[k];
+        low[l][k] = lane.low[k];
+        up[l][k] = lane.up[k];
+      }
+      first[l] = nBins;
+      for(int b = 0; b < nBins; b++)
+      {
+        const double x = 0.5*(edges_[b] + edges_[b + 1]);
+        if(x < lane.xMin || x > lane.xMax) continue;
+        first[l] = std::min(first[l], b);
+        last[l] = b + 1;
+      }
+      firstBin = std::min(firstBin, first[l]);
+      lastBin = std::max(lastBin, last[l]);
+    }
+
+    //counts, n ln(n) - n and range mask, lane last
+    const int nRange = std::max(0, lastBin - firstBin);
+    std::vector<double> n(nRange*NLanes, 0.0), nLogN(nRange*NLanes, 0.0), inRange(nRange*NLanes, 0.0), mu(nRange*NLanes, 1.0);
+    for(int b = 0; b < nRange; b++)
+    {
+      for(int l = 0; l < NLanes; l++)
+      {
+        if(!active[l] || firstBin + b < first[l] || firstBin + b >= last[l]) continue;
+        const double c = lanes[l]->counts[firstBin + b];
+        n[b*NLanes + l] = c;
+        nLogN[b*NLanes + l] = c > 0 ? c*log(c) - c : 0;
+        inRange[b*NLanes + l] = 1;
+      }
+    }
+
+    double L[NLanes] = {}, LTrial[NLanes], lambda[NLanes];
+    double g[maxPar][NLanes] = {}, H[maxPar][maxPar][NLanes] = {};
+    int nIter[NLanes], nEval[NLanes];
+    double edm[NLanes];
+    bool converged[NLanes];
+    for(int l = 0; l < NLanes; l++)
+    {
+      lambda[l] = 1e-3;
+      nIter[l] = 0;
+      nEval[l] = 0;
+      edm[l] = 0;
+      converged[l] = false;
+    }
+
+    bool dirty[NLanes];
+    std::copy(active, active + NLanes, dirty);
+    accumulate(lanes, p, dirty, firstBin, nRange, n, nLogN, inRange, L, g, H);
+    for(int l = 0; l < NLanes; l++) nEval[l] += dirty[l];
+
+    for(int iter = 0; iter < maxIter_; iter++)
+    {
+      //parameters held at their limits, Jacobi scaling and the undamped step for the convergence test
+      double scale[maxPar][NLanes], A[maxPar][maxPar][NLanes], r[maxPar][NLanes], step[maxPar][NLanes];
+      bool held[maxPar][NLanes], ok[NLanes];
+      for(int k = 0; k < nFree; k++)
+      {
+        const int i = free_[k];
+        for(int l = 0; l < NLanes; l++)
+        {
+          const bool bounded = active[l] && low[l][i] < up[l][i];
+          const bool noInformation = active[l] && !(H[k][k][l] > 0);
+          held[k][l] = noInformation || (bounded && ((p[l][i] <= low[l][i] && g[k][l] > 0) || (p[l][i] >= up[l][i] && g[k][l] < 0)));
+          scale[k][l] = H[k][k][l] > 0 ? 1/sqrt(H[k][k][l]) : 1;
+        }
+      }
+      scaledSystem(nFree, 0.0, H, g, scale, held, active, A, r);
+      cholesky(nFree, A, r, step, ok);
+
+      bool any = false;
+      for(int l = 0; l < NLanes; l++)
+      {
+        if(!active[l]) continue;
+        edm[l] = 0;
+        for(int k = 0; k < nFree; k++) edm[l] += 0.5*r[k][l]*step[k][l];
+        if(!ok[l] || !(edm[l] == edm[l]))
+        {
+          active[l] = false;
+        }
+        else if(edm[l] < edmTolerance_)
+        {
+          active[l] = false;
+          converged[l] = true;
+        }
+        any = any || active[l];
+      }
+      if(!any) break;
+
+      //damped steps, clamped into the limits
+      double damping[NLanes];
+      for(int l = 0; l < NLanes; l++) damping[l] = active[l] ? lambda[l] : 0;
+      scaledSystemDamped(nFree, damping, H, g, scale, held, active, A, r);
+      cholesky(nFree, A, r, step, ok);
+      for(int l = 0; l < NLanes; l++)
+      {
+        if(!active[l]) continue;
+        ++nIter[l];
+        for(int k = 0; k < nFree; k++)
+        {
+          const int i = free_[k];
+          double v = p[l][i] + step[k][l]*scale[k][l];
+          if(low[l][i] < up[l][i]) v = std::min(std::max(v, low[l][i]), up[l][i]);
+          trial[l][i] = v;
+        }
+      }
+
+      likelihood(lanes, trial, active, firstBin, nRange, n, nLogN, inRange, mu, LTrial);
+      for(int l = 0; l < NLanes; l++) nEval[l] += active[l];
+
+      for(int l = 0; l < NLanes; l++)
+      {
+        dirty[l] = false;
+        if(!active[l]) continue;
+        if(ok[l] && LTrial[l] < L[l])
+        {
+          std::copy(trial[l], trial[l] + maxPar, p[l]);
+          lambda[l] = std::max(0.3*lambda[l], 1e-9);
+          dirty[l] = true;
+        }
+        else
+        {
+          std::copy(p[l], p[l] + maxPar, trial[l]);
+          lambda[l] *= 10;
+          if(lambda[l] > 1e10) active[l] = false;
+        }
+      }
+      accumulate(lanes, p, dirty, firstBin, nRange, n, nLogN, inRange, L, g, H);
+      for(int l = 0; l < NLanes; l++) nEval[l] += dirty[l];
+    }
+
+    //errors from the inverse information of all free parameters
+    double scale[maxPar][NLanes], A[maxPar][maxPar][NLanes], r[maxPar][NLanes], column[maxPar][NLanes], covariance[maxPar][maxPar][NLanes];
+    bool held[maxPar][NLanes], ok[NLanes], posDef[NLanes];
+    std::fill(posDef, posDef + NLanes, true);
+    for(int k = 0; k < nFree; k++)
+    {
+      for(int l = 0; l < NLanes; l++)
+      {
+        held[k][l] = !(H[k][k][l] > 0);
+        scale[k][l] = H[k][k][l] > 0 ? 1/sqrt(H[k][k][l]) : 1;
+      }
+    }
+    for(int k = 0; k < nFree; k++)
+    {
+      bool all[NLanes];
+      std::fill(all, all + NLanes, true);
+      scaledSystem(nFree, 0.0, H, g, scale, held, all, A, r);
+      for(int j = 0; j < nFree; j++) std::fill(r[j], r[j] + NLanes, j == k ? 1.0 : 0.0);
+      cholesky(nFree, A, r, column, ok);
+      for(int l = 0; l < NLanes; l++) posDef[l] = posDef[l] && ok[l];
+      for(int j = 0; j < nFree; j++)
+      {
+        for(int l = 0; l < NLanes; l++) covariance[k][j][l] = held[k][l] || held[j][l] ? 0 : column[j][l]*scale[j][l]*scale[k][l];
+      }
+    }
+
+    for(int l = 0; l < nUsed; l++)
+    {
+      Lane& lane = *lanes[l];
+      const int nPar = lane.model->getNPar();
+      lane.par.assign(p[l], p[l] + nPar);
+      lane.err.assign(nPar, 0.0);
+      lane.cov.assign(nPar*nPar, 0.0);
+      for(int k = 0; k < nFree; k++)
+      {
+        lane.err[free_[k]] = covariance[k][k][l] > 0 ? sqrt(covariance[k][k][l]) : 0;
+        for(int j = 0; j < nFree; j++) lane.cov[free_[k]*nPar + free_[j]] = covariance[k][j][l];
+      }
+      lane.nll = L[l];
+      lane.nIter = nIter[l];
+      lane.converged = converged[l];
+      lane.edm = edm[l];
+      lane.nEval = nEval[l];
+      lane.posDef = posDef[l];
+    }
+  }
+
+private:
+  std::vector<double> edges_;
+  std::vector<int> free_;
+  double edmTolerance_;
+  int maxIter_;
+
+  //Likelihood, its gradient with respect to the free parameters and the expected information at p, for the dirty lanes
+  void accumulate(const std::vector<Lane*>& lanes, const double p[][maxPar], const bool* dirty, const int firstBin, const int nRange,
+                  const std::vector<double>& n, const std::vector<double>& nLogN, const std::vector<double>& inRange,
+                  double* L, double g[][NLanes], double H[][maxPar][NLanes]) const
+  {
+    const int nFree = free_.size();
+    double w[NLanes], wh[NLanes], use[NLanes], dmu[maxPar][NLanes];
+    double sumL[NLanes], sumG[maxPar][NLanes], sumH[maxPar][maxPar][NLanes];
+    for(int l = 0; l < NLanes; l++)
+    {
+      use[l] = dirty[l] ? 1 : 0;
+      sumL[l] = 0;
+      if(dirty[l]) lanes[l]->model->setPPEParameters(p[l]);
+    }
+    for(int k = 0; k < nFree; k++)
+    {
+      std::fill(sumG[k], sumG[k] + NLanes, 0.0);
+      for(int j = 0; j <= k; j++) std::fill(sumH[k][j], sumH[k][j] + NLanes, 0.0);
+    }
+
+    for(int b = 0; b < nRange; b++)
+    {
+      const double* nb = &n[b*NLanes];
+      double mu[NLanes], m[NLanes];
+      for(int l = 0; l < NLanes; l++)
+      {
+        mu[l] = 1;
+        for(int k = 0; k < nFree; k++) dmu[k][l] = 0;
+        if(!dirty[l] || inRange[b*NLanes + l] == 0) continue;
+        double d[maxPar];
+        mu[l] = lanes[l]->model->binGradient(edges_[firstBin + b], edges_[firstBin + b + 1], p[l], d);
+        for(int k = 0; k < nFree; k++) dmu[k][l] = d[free_[k]];
+      }
+
+      for(int l = 0; l < NLanes; l++)
+      {
+        const double weight = use[l]*inRange[b*NLanes + l];
+        m[l] = std::max(mu[l], 1e-300);
+        sumL[l] += weight*(m[l] - nb[l]*log(m[l]) + nLogN[b*NLanes + l]);
+        w[l] = weight*(1 - nb[l]/m[l]);
+        wh[l] = weight/m[l];
+      }
+      for(int k = 0; k < nFree; k++)
+      {
+        for(int l = 0; l < NLanes; l++) sumG[k][l] += w[l]*dmu[k][l];
+        for(int j = 0; j <= k; j++)
+        {
+          for(int l = 0; l < NLanes; l++) sumH[k][j][l] += wh[l]*dmu[k][l]*dmu[j][l];
+        }
+      }
+    }
+
+    for(int l = 0; l < NLanes; l++)
+    {
+      if(!dirty[l]) continue;
+      L[l] = sumL[l];
+      for(int k = 0; k < nFree; k++)
+      {
+        g[k][l] = sumG[k][l];
+        for(int j = 0; j <= k; j++) H[k][j][l] = H[j][k][l] = sumH[k][j][l];
+      }
+    }
+  }
+
+  //Likelihood alone at p, for the active lanes, through one batch evaluation per lane
+  void likelihood(const std::vector<Lane*>& lanes, const double p[][maxPar], const bool* active, const int firstBin, const int nRange,
+                  const std::vector<double>& n, const std::vector<double>& nLogN, const std::vector<double>& inRange,
+                  std::vector<double>& mu, double* L) const
+  {
+    std::vector<double> a(nRange), b(nRange), laneMu(nRange);
+    for(int i = 0; i < nRange; i++)
+    {
+      a[i] = edges_[firstBin + i];
+      b[i] = edges_[firstBin + i + 1];
+    }
+    for(int l = 0; l < NLanes; l++)
+    {
+      L[l] = 0;
+      if(!active[l]) continue;
+      lanes[l]->model->evalBins(a.data(), b.data(), nRange, p[l], laneMu.data());
+      for(int i = 0; i < nRange; i++) mu[i*NLanes + l] = inRange[i*NLanes + l] > 0 ? laneMu[i] : 1;
+    }
+
+    for(int i = 0; i < nRange; i++)
+    {
+      for(int l = 0; l < NLanes; l++)
+      {
+        const double m = std::max(mu[i*NLanes + l], 1e-300);
+        L[l] += inRange[i*NLanes + l]*(m - n[i*NLanes + l]*log(m) + nLogN[i*NLanes + l]);
+      }
+    }
+  }
+
+  //Jacobi scaled system (D H D + lambda I) x = -D g, held parameters decoupled with x = 0
+  static void scaledSystem(const int nFree, const double lambda, const double H[][maxPar][NLanes], const double g[][NLanes], const double scale[][NLanes],
+                           const bool held[][NLanes], const bool* active, double A[][maxPar][NLanes], double r[][NLanes])
+  {
+    double damping[NLanes];
+    std::fill(damping, damping + NLanes, lambda);
+    scaledSystemDamped(nFree, damping, H, g, scale, held, active, A, r);
+  }
+
+  static void scaledSystemDamped(const int nFree, const double* lambda, const double H[][maxPar][NLanes], const double g[][NLanes], const double scale[][NLanes],
+                                 const bool held[][NLanes], const bool* active, double A[][maxPar][NLanes], double r[][NLanes])
+  {
+    for(int k = 0; k < nFree; k++)
+    {
+      for(int l = 0; l < NLanes; l++) r[k][l] = held[k][l] || !active[l] ? 0 : -g[k][l]*scale[k][l];
+      for(int j = 0; j <= k; j++)
+      {
+        for(int l = 0; l < NLanes; l++)
+        {
+          const bool decoupled = held[k][l] || held[j][l] || !active[l];
+          A[k][j][l] = decoupled ? (j == k ? 1.0 : 0.0) : H[k][j][l]*scale[k][l]*scale[j][l] + (j == k ? lambda[l] : 0.0);
+        }
+      }
+    }
+  }
+
+  //Solve A x = r per lane by Cholesky decomposition of the lower triangle of A (overwritten);
+  //ok is false for lanes where A is not positive definite
+  static void cholesky(const int nFree, double A[][maxPar][NLanes], const double r[][NLanes], double x[][NLanes], bool* ok)
+  {
+    std::fill(ok, ok + NLanes, true);
+    for(int j = 0; j < nFree; j++)
+    {
+      for(int l = 0; l < NLanes; l++)
+      {
+        double d = A[j][j][l];
+        for(int k = 0; k < j; k++) d -= A[j][k][l]*A[j][k][l];
+        if(!(d > 1e-14)) ok[l] = false;
+        A[j][j][l] = sqrt(d > 1e-14 ? d : 1.0);
+      }
+      for(int i = j + 1; i < nFree; i++)
+      {
+        for(int l = 0; l < NLanes; l++)
+        {
+          double s = A[i][j][l];
+          for(int k = 0; k < j; k++) s -= A[i][k][l]*A[j][k][l];
+          A[i][j][l] = s/A[j][j][l];
+        }
+      }
+    }
+
+    for(int i = 0; i < nFree; i++)
+    {
+      for(int l = 0; l < NLanes; l++)
+      {
+        double s = r[i][l];
+        for(int k = 0; k < i; k++) s -= A[i][k][l]*x[k][l];
+        x[i][l] = s/A[i][i][l];
+      }
+    }
+    for(int i = nFree - 1; i >= 0; i--)
+    {
+      for(int l = 0; l < NLanes; l++)
+      {
+        double s = x[i][l];
+        for(int k = i + 1; k < nFree; k++) s -= A[k][i][l]*x[k][l];
+        x[i][l] = s/A[i][i][l];
+      }
+    }
+  }
+};
+
+#endif
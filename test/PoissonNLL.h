@@ -0,0 +1,134 @@
+#ifndef PoissonNLL_h
+#define PoissonNLL_h
+
+#include "SPEfunc.h"
+#include "Minuit2/FCNGradientBase.h"
+#include <memory>
+#include <vector>
+
+//Binned Poisson negative log likelihood of a PPEFunc, for Minuit2 without the TH1/TF1 machinery
+//
+//The bins with their centre in [xMin, xMax] are copied once into contiguous arrays of edges and
+//counts, and every evaluation is one PPEFunc::evalBins call over them (or one binGradient per bin
+//for the gradient).  The expected count of a bin is the model averaged over it.  The value is
+//sum(mu - n + n ln(n/mu)), half the Poisson deviance, so that its minimum is near the number of
+//bins over two and the up value is 0.5; the sums are compensated.  An evaluation runs on the
+//calling thread; channels are fitted in parallel, not the bins of one channel.
+
+//Neumaier's compensated sum
+struct CompensatedSum
+{
+  double sum = 0;
+  double c = 0;
+
+  void add(const double x)
+  {
+    const double t = sum + x;
+    c += std::fabs(sum) >= std::fabs(x) ? (sum - t) + x : (x - t) + sum;
+    sum = t;
+  }
+
+  double result() const { return sum + c; }
+};
+
+class PoissonNLL : public ROOT::Minuit2::FCNGradientBase
+{
+public:
+  //Bins of h with their centre in [xMin, xMax]
+  PoissonNLL(const std::shared_ptr<PPEFunc>& model, TH1* h, const double xMin, const double xMax)
+  {
+    std::vector<double> edges, counts;
+    for(int i = 1; i <= h->GetNbinsX(); i++)
+    {
+      edges.push_back(h->GetXaxis()->GetBinLowEdge(i));
+      counts.push_back(h->GetBinContent(i));
+    }
+    edges.push_back(h->GetXaxis()->GetBinUpEdge(h->GetNbinsX()));
+    init(model, edges, counts, xMin, xMax);
+  }
+
+  //Bins [edges[i], edges[i + 1]] with counts[i]
+  PoissonNLL(const std::shared_ptr<PPEFunc>& model, const std::vector<double>& edges, const std::vector<double>& counts, const double xMin, const double xMax)
+  {
+    init(model, edges, counts, xMin, xMax);
+  }
+
+  int getNBins() const { return n_.size(); }
+  //calls of value(), with or without the gradient, i.e. model evaluations over the bins
+  int getNEval() const { return nEval_; }
+
+  //Negative log likelihood at p, and its gradient sum (1 - n/mu) dmu/dp if grad is given
+  double value(const double* p, double* grad = nullptr) const
+  {
+    PPEFunc& model = *model_;
+    const int nBins = n_.size();
+    const int nPar = model.getNPar();
+    ++nEval_;
+
+    //mu below the smallest positive double would make the log infinite
+    const double muMin = 1e-300;
+    CompensatedSum total;
+    if(!grad)
+    {
+      model.evalBins(a_.data(), b_.data(), nBins, p, mu_.data());
+      for(int i = 0; i < nBins; i++)
+      {
+        const double mu = std::max(mu_[i], muMin);
+        total.add(mu - n_[i]*log(mu) + nLogN_[i]);
+      }
+      return total.result();
+    }
+
+    CompensatedSum g[14];
+    double dmu[14];
+    model.setPPEParameters(p);
+    for(int i = 0; i < nBins; i++)
+    {
+      const double mu = std::max(model.binGradient(a_[i], b_[i], p, dmu), muMin);
+      total.add(mu - n_[i]*log(mu) + nLogN_[i]);
+      const double w = 1 - n_[i]/mu;
+      for(int k = 0; k < nPar; k++) g[k].add(w*dmu[k]);
+    }
+    for(int k = 0; k < nPar; k++) grad[k] = g[k].result();
+    return total.result();
+  }
+
+  double operator()(const std::vector<double>& p) const override { return value(p.data()); }
+
+  std::vector<double> Gradient(const std::vector<double>& p) const override
+  {
+    std::vector<double> grad(model_->getNPar());
+    value(p.data(), grad.data());
+    return grad;
+  }
+
+  //the analytic gradient is checked in modelValidation, not at the start of every fit
+  bool CheckGradient() const override { return false; }
+
+  double Up() const override { return 0.5; }
+
+private:
+  std::vector<double> a_, b_, n_;
+  //n ln(n) - n per bin, independent of the parameters
+  std::vector<double> nLogN_;
+  std::shared_ptr<PPEFunc> model_;
+  mutable std::vector<double> mu_;
+  mutable int nEval_ = 0;
+
+  void init(const std::shared_ptr<PPEFunc>& model, const std::vector<double>& edges, const std::vector<double>& counts, const double xMin, const double xMax)
+  {
+    model_ = model;
+    for(unsigned int i = 0; i < counts.size(); i++)
+    {
+      const double x = 0.5*(edges[i] + edges[i + 1]);
+      if(x < xMin || x > xMax) continue;
+      a_.push_back(edges[i]);
+      b_.push_back(edges[i + 1]);
+      n_.push_back(counts[i]);
+      nLogN_.push_back(counts[i] > 0 ? counts[i]*log(counts[i]) - counts[i] : 0);
+    }
+    mu_.resize(n_.size());
+  }
+};
+
+#endif
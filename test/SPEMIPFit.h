@@ -0,0 +1,603 @@
+#ifndef SPEMIPFit_h
+#define SPEMIPFit_h
+
+#include "SPEfunc.h"
+#include "FitPipeline.h"
+#include "SpectrumEstimate.h"
+#include "../include/FitParameterStore.h"
+#include "../include/ProcessPool.h"
+#include "TH1D.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+//Fit and plot of the SiPM pedestal, PE and MIP spectrum of single channels, as run by mipFitsSiPM
+
+//Final parameters of one channel
+struct ChannelFit {
+    std::vector<double> par;
+    std::vector<double> err;
+    //covariance of par, row major
+    std::vector<double> cov;
+    double chi2;
+    int nBins;
+    int status;
+    //started from the stored result of the channel, and accepted
+    bool warmStarted;
+    //started from the parameters estimated from the spectrum, and accepted
+    bool estimated;
+    //wall time of the fits of the channel, shared with the channels fitted alongside
+    double fitSeconds;
+    std::vector<StageResult> stages;
+    //stages of earlier fits of the channel that were not kept (rejected warm and estimated starts),
+    //for the telemetry
+    std::vector<StageResult> discarded;
+};
+
+//The fit cascade of fitSPEMIP: background, pedestal, PE peaks, PE fine tuning, MIP peak, all
+inline std::vector<FitStage> spemipStages()
+{
+    const int nPeaks = 6;
+                                                       ////////////////////////////////////////////////////////////
+    double min0  =  4500; double max0  =    5300;      //p[0]  : pedestal amplitude-------------//               //
+    double min1  =   2.0; double max1  =    10.0;      //p[1]  : pedestal width-----------------//               //
+    double min2  =     0; double max2  =     200;      //p[2]  : Overall Shift------------------//(avg. pedestal)//
+    double min3  =     0; double max3  =    2000;      //p[3]  : background amplitude-----------//               //
+    double min4  =     0; double max4  =      10;      //p[4]  : background width---------------//               //
+
+    double min5  =  3000; double max5  =    6000;      //p[5]  : overall PE amplitude ----------//               //
+    double min6  =  0.05; double max6  =     0.3;      //p[6]  : poisson mean number of PE------//               //
+    double min7  =   140; double max7  =     150;      //p[7]  : PE peak spacing----------------//(Gain)         //
+    double min8  =    12; double max8  =      18;      //p[8]  : PE peak width------------------//               //
+    double min9  =  0.02; double max9  =    0.06;      //p[9]  : pixel cross-talk probability---//               //
+                                                       ////////////////////////////////////////////////////////////
+
+    double set0  =  4900;
+    double set1  =     8;
+    double set2  =   140;
+    double set3  =  2000;
+    double set4  =     5;
+
+    double set5  =  5000;
+    double set6  =  0.15;
+    double set7  =   140;
+    double set8  =  15.0;
+    double set9  =  0.05;
+
+    double set10 =     0;
+    double set11 =     0;
+    double set12 =    50;
+    double set13 =   100;
+
+    typedef ParRule P;
+    typedef RangeEdge R;
+    return {
+        //Fit Background Peak
+        {"background", 3, false, R::at(0), R::at(1000), {
+            P::fix(0.01),  P::fix(set1),  P::fix(set2),
+            P::free(set3).within(min3, max3),  P::free(set4).within(min4, max4),
+            P::fix(0.01),  P::fix(set6),  P::fix(set7),  P::fix(set8),  P::fix(set9)}, false},
+
+        //Fit Pedestal Peak
+        {"pedestal", 3, false, R::at(130), R::at(160), {
+            P::free(set0).within(min0, max0),  P::free(set1).within(min1, max1),  P::free(set2).within(min2, max2),
+            P::fixPrevious(),  P::fixPrevious(),
+            P::fix(0.01),  P::fix(set6),  P::fix(set7),  P::fix(set8),  P::fix(set9)}, false},
+
+        //fit PE Peaks
+        {"PE peaks", 3, false, R::atPrevious(2), R::at(450), {
+            P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),
+            P::freePrevious().within(min3, max3),  P::freePrevious().within(min4, max4),
+            P::free(set5).within(min5, max5),  P::free(set6).within(min6, max6),  P::free(set7).within(min7, max7),
+            P::free(set8).within(min8, max8),  P::free(set9).within(min9, max9)}, false},
+
+        //Fine tune PE peaks
+        {"PE fine tune", nPeaks, false, R::at(450), R::at(1000), {
+            P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),
+            P::freePrevious().scaled(0.5, 1.5),  P::freePrevious().scaled(0.85, 1.5),
+            P::freePrevious().scaled(0.5, 1.5),  P::freePrevious().scaled(0.5, 1.5)}, true},
+
+        //Fit MIP peak; every parameter is fixed, the stage only sets the MIP start values
+        {"MIP", nPeaks, true, R::atPrevious(2), R::at(1000), {
+            P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),
+            P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),
+            P::fix(set10),  P::fix(set11),  P::fix(set12),  P::fix(set13)}, false},
+
+        //Fine Tunning All Fit
+        {"all", nPeaks, true, R::atPrevious(2), R::at(1500), {
+            P::freePrevious().scaled(0.95, 1.05),  P::freePrevious().scaled(0.95, 1.05),  P::freePrevious().scaled(0.95, 1.05),
+            P::freePrevious().scaled(0.95, 1.0),   P::freePrevious().scaled(0.95, 1.0),
+            P::freePrevious().scaled(0.95, 1.05),  P::freePrevious().scaled(0.95, 1.05),  P::freePrevious().scaled(0.95, 1.05),
+            P::freePrevious().scaled(0.95, 1.0),   P::freePrevious().scaled(0.95, 1.05),
+            P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious()}, true},
+    };
+}
+
+//Cascade started from the stored result of a channel: the pedestal, which moves most between
+//runs, then everything but the MIP shape within 10% of the stored values
+inline std::vector<FitStage> warmStartStages()
+{
+    const int nPeaks = 6;
+
+    typedef ParRule P;
+    typedef RangeEdge R;
+    return {
+        {"warm pedestal", nPeaks, true, R::atPrevious(2, -10), R::atPrevious(2, 20), {
+            P::freePrevious().scaled(0.8, 1.2),    P::freePrevious().scaled(0.8, 1.2),    P::freePrevious().scaled(0.95, 1.05),
+            P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),
+            P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious()}, false},
+
+        {"warm all", nPeaks, true, R::atPrevious(2), R::at(1500), {
+            P::freePrevious().scaled(0.9, 1.1),  P::freePrevious().scaled(0.9, 1.1),  P::freePrevious().scaled(0.9, 1.1),
+            P::freePrevious().scaled(0.9, 1.1),  P::freePrevious().scaled(0.9, 1.1),
+            P::freePrevious().scaled(0.9, 1.1),  P::freePrevious().scaled(0.9, 1.1),  P::freePrevious().scaled(0.9, 1.1),
+            P::freePrevious().scaled(0.9, 1.1),  P::freePrevious().scaled(0.9, 1.1),
+            P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious()}, true},
+    };
+}
+
+//Cascade started from the parameters estimated from the spectrum (seed): the start values, limits
+//and ranges follow the pedestal and gain of the channel instead of the defaults of spemipStages
+inline std::vector<FitStage> estimatedStages()
+{
+    const int nPeaks = 6;
+    double min3  =     0; double max3  =    2000;      //p[3]  : background amplitude
+    double min4  =     0; double max4  =      10;      //p[4]  : background width
+    double min9  =  0.02; double max9  =    0.06;      //p[9]  : pixel cross-talk probability
+
+    double set3  =  2000;
+    double set4  =     5;
+    double set9  =  0.05;
+
+    double set10 =     0;
+    double set12 =    50;
+    double set13 =   100;
+
+    typedef ParRule P;
+    typedef RangeEdge R;
+    return {
+        {"background", 3, false, R::at(0), R::at(1000), {
+            P::fix(0.01),  P::fixSeed(),  P::fixSeed(),
+            P::free(set3).within(min3, max3),  P::free(set4).within(min4, max4),
+            P::fix(0.01),  P::fixSeed(),  P::fixSeed(),  P::fixSeed(),  P::fixSeed()}, false},
+
+        {"pedestal", 3, false, R::atSeed(2).plus(-1.5, 1), R::atSeed(2).plus(2.5, 1), {
+            P::freeSeed().scaled(0.7, 1.4),  P::freeSeed().scaled(0.5, 2),  P::freeSeed().around(3, 1),
+            P::fixPrevious(),  P::fixPrevious(),
+            P::fix(0.01),  P::fixSeed(),  P::fixSeed(),  P::fixSeed(),  P::fixSeed()}, false},
+
+        {"PE peaks", 3, false, R::atPrevious(2), R::atPrevious(2).plus(2.2, 7), {
+            P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),
+            P::freePrevious().within(min3, max3),  P::freePrevious().within(min4, max4),
+            P::freeSeed().scaled(0.5, 2),  P::freeSeed().scaled(0.5, 2),  P::freeSeed().scaled(0.93, 1.07),
+            P::freeSeed().scaled(0.6, 1.5),  P::free(set9).within(min9, max9)}, false},
+
+        {"PE fine tune", nPeaks, false, R::atPrevious(2).plus(2.2, 7), R::atPrevious(2).plus(6, 7), {
+            P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),
+            P::freePrevious().scaled(0.5, 1.5),  P::freePrevious().scaled(0.85, 1.5),
+            P::freePrevious().scaled(0.5, 1.5),  P::freePrevious().scaled(0.5, 1.5)}, true},
+
+        //the MIP stays off as in spemipStages, its position is the estimated one
+        {"MIP", nPeaks, true, R::atPrevious(2), R::at(1000), {
+            P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),
+            P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),
+            P::fix(set10),  P::fixSeed(),  P::fix(set12),  P::fix(set13)}, false},
+
+        {"all", nPeaks, true, R::atPrevious(2), R::at(1500), {
+            P::freePrevious().scaled(0.95, 1.05),  P::freePrevious().scaled(0.95, 1.05),  P::freePrevious().scaled(0.95, 1.05),
+            P::freePrevious().scaled(0.95, 1.0),   P::freePrevious().scaled(0.95, 1.0),
+            P::freePrevious().scaled(0.95, 1.05),  P::freePrevious().scaled(0.95, 1.05),  P::freePrevious().scaled(0.95, 1.05),
+            P::freePrevious().scaled(0.95, 1.0),   P::freePrevious().scaled(0.95, 1.05),
+            P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious(),  P::fixPrevious()}, true},
+    };
+}
+
+//Seed of estimatedStages, with the defaults of spemipStages for what the spectrum does not give
+inline StageResult estimatedSeed(const SpectrumEstimate& e)
+{
+    StageResult seed;
+    seed.name = "estimate";
+    seed.par = {e.pedAmplitude, e.pedWidth, e.pedestal, 2000, 5,
+                e.peAmplitude, e.meanPE, e.gain, e.peWidth, 0.05,
+                0, e.mipFound ? e.mipMPV : 500, 50, 100};
+    seed.err.assign(seed.par.size(), 0.0);
+    seed.xMin = seed.xMax = 0;
+    seed.chi2 = 0;
+    seed.status = 0;
+    seed.skipped = false;
+    seed.nAtLimit = 0;
+    seed.seconds = 0;
+    seed.nEval = 0;
+    seed.edm = 0;
+    seed.covQual = -1;
+    return seed;
+}
+
+//A warm started fit is kept if every stage converged away from its limits and the deviance per
+//bin is at most twice the stored one; otherwise the channel is refitted from the defaults
+inline bool acceptWarmStart(const ChannelFit& fit, const FitParameterStore::Entry& seed)
+{
+    for(const StageResult& stage : fit.stages)
+    {
+        if(!stage.skipped && (stage.status != 0 || stage.nAtLimit > 0)) return false;
+    }
+    return fit.nBins > 0 && seed.nBins > 0 && fit.chi2/fit.nBins <= 2*seed.chi2/seed.nBins;
+}
+
+//A fit started from the spectrum estimate is kept if every stage converged with neither the
+//pedestal nor the gain at a limit, and the gain is within 5 % of the estimated one: a fit which
+//pulls them away from the estimate found other peaks (e.g. a MIP peak taken for a PE peak).  Other
+//parameters may end at their limits, the first stage fits the background alone and always does as
+//in spemipStages.  Otherwise the channel is refitted from the defaults
+inline bool acceptEstimatedStart(const ChannelFit& fit, const StageResult& seed)
+{
+    for(const StageResult& stage : fit.stages)
+    {
+        if(stage.skipped) continue;
+        if(stage.status != 0 || (stage.atLimit.size() > 7 && (stage.atLimit[2] || stage.atLimit[7]))) return false;
+    }
+    return seed.par[7] > 0 && std::fabs(fit.par[7]/seed.par[7] - 1) <= 0.05;
+}
+
+inline ChannelFit channelFit(const std::vector<StageResult>& stages, const FitContext& context, const bool warmStarted)
+{
+    ChannelFit result;
+    result.stages = stages;
+    const StageResult& last = result.stages.back();
+    result.par = last.par;
+    result.err = last.err;
+    result.cov = last.cov;
+    result.chi2 = last.chi2;
+    result.nBins = context.countBins(last.xMin, last.xMax);
+    result.status = last.status;
+    result.warmStarted = warmStarted;
+    result.estimated = false;
+    result.fitSeconds = 0;
+    return result;
+}
+
+//Replace the fit of a channel by a later one, keeping the stages of the earlier fits
+inline void replaceFit(ChannelFit& fit, const ChannelFit& later)
+{
+    std::vector<StageResult> discarded = fit.discarded;
+    discarded.insert(discarded.end(), fit.stages.begin(), fit.stages.end());
+    fit = later;
+    fit.discarded = discarded;
+}
+
+//Channels fitted in lock step, one per lane; 1 fits every channel on its own with Minuit
+const int fitLanes = 4;
+
+//This function fits the SiPM MIP distributions of hists, each from its stored result if there is
+//one, else from the parameters estimated from its spectrum, and from the defaults if either fails;
+//it only touches hists and objects of its own, so several groups can be fitted at once
+inline std::vector<ChannelFit> fitSPEMIP(const std::vector<TH1*>& hists, const std::vector<const FitParameterStore::Entry*>& stored)
+{
+    static const FitPipeline pipeline(spemipStages());
+    static const FitPipeline warmPipeline(warmStartStages());
+    static const FitPipeline estimatedPipeline(estimatedStages());
+
+    //all stages share the models and bin contents of a histogram
+    std::vector<std::unique_ptr<FitContext>> contexts;
+    for(TH1* hfit : hists) contexts.emplace_back(new FitContext(hfit));
+
+    std::vector<ChannelFit> fits(hists.size());
+    std::vector<double> seconds(hists.size(), 0.0);
+
+    //runs p on the channels index and adds its time, shared evenly, to theirs
+    auto run = [&seconds](const FitPipeline& p, const std::vector<FitContext*>& c, const std::vector<int>& index, const std::vector<const StageResult*>& seeds)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<std::vector<StageResult>> results;
+        if(fitLanes > 1) results = p.runLanes<fitLanes>(c, seeds);
+        else
+        {
+            for(unsigned int i = 0; i < c.size(); i++) results.push_back(p.run(*c[i], seeds.empty() ? nullptr : seeds[i]));
+        }
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for(int i : index) seconds[i] += elapsed/index.size();
+        return results;
+    };
+
+    std::vector<FitContext*> warm, cold;
+    std::vector<int> warmIndex, coldIndex;
+    std::vector<StageResult> seeds;
+    for(unsigned int i = 0; i < hists.size(); i++)
+    {
+        const FitParameterStore::Entry* entry = stored[i];
+        if(!entry || entry->par.size() != 14 || entry->err.size() != 14)
+        {
+            cold.push_back(contexts[i].get());
+            coldIndex.push_back(i);
+            continue;
+        }
+
+        StageResult seed;
+        seed.name = "stored";
+        seed.par = entry->par;
+        seed.err = entry->err;
+        seed.xMin = seed.xMax = 0;
+        seed.chi2 = entry->chi2;
+        seed.status = 0;
+        seed.skipped = false;
+        seed.nAtLimit = 0;
+        seed.seconds = 0;
+        seed.nEval = 0;
+        seed.edm = 0;
+        seed.covQual = -1;
+        seeds.push_back(seed);
+        warm.push_back(contexts[i].get());
+        warmIndex.push_back(i);
+    }
+
+    std::vector<const StageResult*> seedPtrs;
+    for(const StageResult& seed : seeds) seedPtrs.push_back(&seed);
+    const auto warmResults = run(warmPipeline, warm, warmIndex, seedPtrs);
+    std::vector<char> done(hists.size(), 0);
+    for(unsigned int j = 0; j < warm.size(); j++)
+    {
+        const int i = warmIndex[j];
+        fits[i] = channelFit(warmResults[j], *warm[j], true);
+        done[i] = acceptWarmStart(fits[i], *stored[i]);
+        if(done[i]) continue;
+        cold.push_back(warm[j]);
+        coldIndex.push_back(i);
+    }
+
+    //cold channels start from their spectrum if it shows the pedestal and PE peaks
+    std::vector<FitContext*> estimated;
+    std::vector<int> estimatedIndex;
+    std::vector<StageResult> estimates;
+    for(unsigned int j = 0; j < cold.size(); j++)
+    {
+        const SpectrumEstimate e = estimateSpectrum(cold[j]->getEdges(), cold[j]->getCounts());
+        if(!e.valid) continue;
+        estimates.push_back(estimatedSeed(e));
+        estimated.push_back(cold[j]);
+        estimatedIndex.push_back(coldIndex[j]);
+    }
+    std::vector<const StageResult*> estimatePtrs;
+    for(const StageResult& seed : estimates) estimatePtrs.push_back(&seed);
+    const auto estimatedResults = run(estimatedPipeline, estimated, estimatedIndex, estimatePtrs);
+    for(unsigned int j = 0; j < estimated.size(); j++)
+    {
+        const int i = estimatedIndex[j];
+        replaceFit(fits[i], channelFit(estimatedResults[j], *estimated[j], false));
+        fits[i].estimated = true;
+        done[i] = acceptEstimatedStart(fits[i], estimates[j]);
+    }
+
+    std::vector<FitContext*> fallback;
+    std::vector<int> fallbackIndex;
+    for(unsigned int j = 0; j < cold.size(); j++)
+    {
+        if(done[coldIndex[j]]) continue;
+        fallback.push_back(cold[j]);
+        fallbackIndex.push_back(coldIndex[j]);
+    }
+    const auto fallbackResults = run(pipeline, fallback, fallbackIndex, {});
+    for(unsigned int j = 0; j < fallback.size(); j++) replaceFit(fits[fallbackIndex[j]], channelFit(fallbackResults[j], *fallback[j], false));
+
+    for(unsigned int i = 0; i < fits.size(); i++) fits[i].fitSeconds = seconds[i];
+    return fits;
+}
+
+//What plotSPEMIP draws of one channel, without ROOT objects, so that the fits can hand their
+//plots on to be drawn later and elsewhere (see renderPlots)
+struct PlotDescription {
+    std::string name;
+    //bins [edges[i], edges[i + 1]] of the fitted histogram
+    std::vector<double> edges;
+    std::vector<double> contents;
+    std::vector<double> errors;
+    std::vector<double> par;
+    //annotations: MIP most probable value, SiPM gain and pedestal
+    double mpv;
+    double gain;
+    double pedestal;
+};
+
+inline PlotDescription describePlot(TH1* hfit, const ChannelFit& fit)
+{
+    PlotDescription plot;
+    plot.name = hfit->GetName();
+    for(int i = 1; i <= hfit->GetNbinsX(); i++)
+    {
+        plot.edges.push_back(hfit->GetXaxis()->GetBinLowEdge(i));
+        plot.contents.push_back(hfit->GetBinContent(i));
+        plot.errors.push_back(hfit->GetBinError(i));
+    }
+    plot.edges.push_back(hfit->GetXaxis()->GetBinUpEdge(hfit->GetNbinsX()));
+    plot.par = fit.par;
+    plot.mpv = fit.par[11];
+    plot.gain = fit.par[7];
+    plot.pedestal = fit.par[2];
+    return plot;
+}
+
+//Take ownership of obj, a function or label drawn on a canvas, which only refers to it
+template<typename T> T* keepDrawn(std::vector<std::unique_ptr<TObject>>& drawn, T* obj)
+{
+    drawn.emplace_back(obj);
+    return obj;
+}
+
+//Draw the spectrum with its fit and print it to fileName, which takes ROOT's "file.pdf(" and
+//"file.pdf)" for the first and last page of a multi-page PDF.  Everything drawn is deleted after
+//the canvas and kept out of the global lists, so plotting many channels does not add up
+inline void plotSPEMIP(const PlotDescription& plot, const std::string& fileName)
+{
+    std::vector<std::unique_ptr<TObject>> drawn;
+    TH1D* hfit = keepDrawn(drawn, new TH1D(plot.name.c_str(), plot.name.c_str(), plot.contents.size(), plot.edges.data()));
+    hfit->SetDirectory(nullptr);
+    for(unsigned int i = 0; i < plot.contents.size(); i++)
+    {
+        hfit->SetBinContent(i + 1, plot.contents[i]);
+        hfit->SetBinError(i + 1, plot.errors[i]);
+    }
+    const std::string cname = "c1_" + std::string(hfit->GetName());
+    TCanvas c1(cname.c_str(),cname.c_str(),800,800);
+    gPad->SetTopMargin(0.1);
+    gPad->SetBottomMargin(0.12);
+    gPad->SetRightMargin(0.05);
+    gPad->SetLeftMargin(0.14);
+    //c1.SetLogx();
+    c1.SetLogy();
+    //hfit->GetXaxis()->SetRangeUser(10, 400);
+    hfit->GetXaxis()->SetRangeUser(1, 1500);
+    hfit->SetMinimum(0.1);
+    hfit->SetMaximum(70000);
+    hfit->Draw("E hist");
+
+    PPEFunc background_MIP(6,true);
+    background_MIP.h = hfit;
+    background_MIP.setBinEdges(hfit);
+
+    hfit->GetYaxis()->SetTitle("Events / ADC bin");
+    hfit->GetXaxis()->SetTitle("ADC Counts");
+    hfit->SetTitleOffset(1,"X");
+    hfit->SetTitleOffset(1.2,"Y");
+    hfit->SetTitleSize(0.05,"X");
+    hfit->SetTitleSize(0.05,"Y");
+    
+    const std::string drawName = "BackGround_MIP_" + std::string(hfit->GetName());
+    TF1* draw5PE = keepDrawn(drawn, new TF1(drawName.c_str(), background_MIP, 50.0, 2000.0, 14, 1, TF1::EAddToList::kNo));
+    draw5PE->FixParameter(0,  plot.par[0]);
+    draw5PE->FixParameter(1,  plot.par[1]);
+    draw5PE->FixParameter(2,  plot.par[2]);
+    draw5PE->FixParameter(3,  plot.par[3]);
+    draw5PE->FixParameter(4,  plot.par[4]);
+    draw5PE->FixParameter(5,  plot.par[5]);
+    draw5PE->FixParameter(6,  plot.par[6]);
+    draw5PE->FixParameter(7,  plot.par[7]);
+    draw5PE->FixParameter(8,  plot.par[8]);
+    draw5PE->FixParameter(9,  plot.par[9]);
+    draw5PE->FixParameter(10, plot.par[10]);
+    draw5PE->FixParameter(11, plot.par[11]);
+    draw5PE->FixParameter(12, plot.par[12]);
+    draw5PE->FixParameter(13, plot.par[13]);
+    draw5PE->SetLineWidth(2);
+    draw5PE->SetLineColor(kBlue);
+    draw5PE->Draw("same");
+    
+    const std::string langName = "Lang_" + std::string(hfit->GetName());
+    TF1* draw5Mip = keepDrawn(drawn, new TF1(langName.c_str(), langautab, 50.0, 2000.0, 4, 1, TF1::EAddToList::kNo));
+    draw5Mip->FixParameter(0, plot.par[12]);
+    draw5Mip->FixParameter(1, plot.par[11]+plot.par[2]);
+    draw5Mip->FixParameter(2, plot.par[10]);
+    draw5Mip->FixParameter(3, plot.par[13]);
+    draw5Mip->SetLineWidth(2);
+    draw5Mip->SetLineColor(kGreen+2);
+    // draw5Mip->Draw("same");
+    
+    //Make Plots Pretty
+    hfit->SetStats(false);
+    hfit->SetTitle("");
+    
+    TLatex* CMSPrelim1 = keepDrawn(drawn, new TLatex(0.14, 0.91, "3mm SiPM"));
+    //TLatex* CMSPrelim1 = new TLatex(0.14, 0.91, "Cherenkov Fiber");
+    CMSPrelim1->SetNDC();
+    CMSPrelim1->SetTextFont(42);
+    
+    TLatex* testbeam = keepDrawn(drawn, new TLatex(0.95, 0.91, "HG-DREAM 2025"));
+    testbeam->SetNDC();
+    testbeam->SetTextFont(42);
+    testbeam->SetTextAlign(31);
+    
+    TLatex* SiPMTitle = keepDrawn(drawn, new TLatex(0.93, 0.86, "SiPM (Silicon Photomultiplier)"));
+    SiPMTitle->SetNDC();
+    SiPMTitle->SetTextFont(42);
+    SiPMTitle->SetTextAlign(32);
+    
+    TLatex* Muon = keepDrawn(drawn, new TLatex(0.93, 0.87, "Cosmics"));
+    Muon->SetNDC();
+    Muon->SetTextFont(42);
+    Muon->SetTextAlign(32);
+    
+    // char chan [100];
+    // int iEta, iPhi, iDepth;
+    // //sscanf (hfit->GetName(),"beam_adc_%d_%d_%d", &iEta, &iPhi, &iDepth);
+    // //sscanf (hfit->GetName(),"adc_nosub_%d_%d_%d", &iEta, &iPhi, &iDepth);
+    // //sscanf (hfit->GetName(),"adc_nosub_constBin_%d_%d_%d", &iEta, &iPhi, &iDepth);
+    // sscanf (hfit->GetName(),"adc_nosub_binChris_%d_%d_%d", &iEta, &iPhi, &iDepth);
+    // //sscanf (hfit->GetName(),"ped_adc_%d_%d_%d", &iEta, &iPhi, &iDepth);
+    // sprintf (chan, "Channel: %d,%d,%d", iEta, iPhi, iDepth);
+    
+    // TLatex* channel = new TLatex(0.93, 0.86, chan);
+    // channel->SetNDC();
+    // channel->SetTextFont(42);
+    // channel->SetTextAlign(32);
+    
+    char mpv [100];
+    float intmpv = plot.mpv;
+    sprintf (mpv,"MPV: %0.3f", intmpv);
+    
+    TLatex* MPV = keepDrawn(drawn, new TLatex(0.93, 0.8, mpv));
+    MPV->SetNDC();
+    MPV->SetTextFont(42);
+    MPV->SetTextAlign(31);
+    
+    char gain [100];
+    float intgain = plot.gain;
+    sprintf (gain,"SiPM Gain: %0.3f", intgain);
+    
+    TLatex* Gain = keepDrawn(drawn, new TLatex(0.93, 0.75, gain));
+    Gain->SetNDC();
+    Gain->SetTextFont(42);
+    Gain->SetTextAlign(31);
+
+    char ped [100];
+    float intped = plot.pedestal;
+    sprintf (ped,"Pedestal: %0.3f", intped);
+    
+    TLatex* Ped = keepDrawn(drawn, new TLatex(0.93, 0.7, ped));
+    Ped->SetNDC();
+    Ped->SetTextFont(42);
+    Ped->SetTextAlign(31);    
+
+    //CMSPrelim1->Draw();
+    testbeam->Draw();
+    //SiPMTitle->Draw();
+    Muon->Draw();
+    //channel->Draw();
+    MPV->Draw();
+    Gain->Draw();
+    Ped->Draw();
+    
+    //sprintf(oname, "%s_SiPMRuns_3030to3475.pdf", hfit->GetName());
+    //sprintf(oname, "%s_HBRuns_3526to3534.pdf", hfit->GetName());
+    c1.Print(fileName.c_str());
+}
+
+//Draw the plots in nProcesses worker processes, after the fits and away from them, as ROOT
+//graphics are not thread-safe.  output is either an image format ("pdf", "png", ...), for one
+//file per channel named after it, or the name of one multi-page PDF ("plots.pdf") with a page
+//per channel in their order; a PDF is written sequentially, so that one takes a single worker.
+//"none" draws nothing.
+inline void renderPlots(const std::vector<PlotDescription>& plots, const std::string& output, const int nProcesses)
+{
+    if(output == "none" || plots.empty()) return;
+    const bool pages = output.find('.') != std::string::npos;
+    ProcessPool pool(pages ? 1 : nProcesses);
+    pool.run(pages ? 1 : plots.size(), [&](int iTask)
+    {
+        gROOT->SetBatch(true);
+        if(!pages)
+        {
+            plotSPEMIP(plots[iTask], plots[iTask].name + "." + output);
+            return;
+        }
+        for(unsigned int i = 0; i < plots.size(); i++)
+        {
+            std::string fileName = output;
+            if(plots.size() > 1 && i == 0) fileName += "(";
+            else if(plots.size() > 1 && i + 1 == plots.size()) fileName += ")";
+            plotSPEMIP(plots[i], fileName);
+        }
+    });
+}
+
+#endif
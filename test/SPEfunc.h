@@ -12,9 +12,14 @@
 #include "TDirectory.h"
 #include "TList.h"
 #include "TLatex.h"
+#include "Math/Types.h"
+#include "LandauTable.h"
+#include "LangauFFT.h"
 #include <cmath>
 #include <cstdio>
 #include <vector>
+#include <algorithm>
+#include <memory>
 
 double crystalBall(double* x, double* p)
 {
@@ -99,70 +104,283 @@ Double_t langaufun(Double_t *x, Double_t *par)
   return (par[2] * step * sum * invsq2pi / par[3]);
 }
 
+// landau-gaussian convolution from the precomputed LandauTable, same parameters as langaufun
+Double_t langautab(Double_t *x, Double_t *par)
+{
+  return LandauTable::instance().langau(x, par);
+}
+
+//Number of ways one primary avalanche fires k cells in total through crosstalk when every
+//fired cell has n neighbours, CPn(k) = binom(k n, k - 1)/k (see the paper referenced in PPEFunc)
+constexpr double crosstalkCombinatorics(const int k, const int n)
+{
+  double c = 1.0/k;
+  for(int i = 1; i < k; i++) c *= double(k*n - (k - 1) + i)/i;
+  return c;
+}
+
+//CPn(1..NPeaks) for a fixed number of neighbours, filled at compile time
+template<int N, int NPeaks> struct CrosstalkTable
+{
+  double CPn[NPeaks + 1];
+
+  constexpr CrosstalkTable() : CPn()
+  {
+    for(int k = 1; k <= NPeaks; k++) CPn[k] = crosstalkCombinatorics(k, N);
+  }
+};
+
+constexpr int crosstalkTablePeaks = 40;
+constexpr CrosstalkTable<4, crosstalkTablePeaks> crosstalkTable4;
+constexpr CrosstalkTable<8, crosstalkTablePeaks> crosstalkTable8;
+
+//Pedestal, photoelectron peaks and background of PPEFunc at xs = x - p[2] with the peak amplitudes
+//sc, written out instead of going through the "gaus" and "landau" TF1s.  NPeaks > 0 fixes the
+//number of peaks at compile time so that the peak loop is unrolled, NPeaks = 0 takes nPeaks.
+template<int NPeaks> double ppeKernel(const double xs, const double* p, const double* sc, const int nPeaks)
+{
+  const int np = NPeaks > 0 ? NPeaks : nPeaks;
+  const double u = xs/p[1];
+  double g = p[0]*exp(-0.5*u*u);
+  const double invWidth = 1/p[8];
+  for(int i = 1; i <= np; i++)
+  {
+    const double v = (xs - (i-1)*p[7])*invWidth;
+    g += sc[i]*p[5]*exp(-0.5*v*v);
+  }
+  return g + p[3]*LandauTable::instance().landau(xs + 50, 0, p[4]);
+}
+
+//ppeKernel for nPoints positions, one term at a time over all points so the loops vectorize
+template<int NPeaks> void ppeKernelBatch(const double* x, const int nPoints, const double* p, const double* sc, const int nPeaks, double* result)
+{
+  const int np = NPeaks > 0 ? NPeaks : nPeaks;
+  const double invPedWidth = 1/p[1];
+  const double invWidth = 1/p[8];
+  for(int j = 0; j < nPoints; j++)
+  {
+    const double u = (x[j] - p[2])*invPedWidth;
+    result[j] = p[0]*exp(-0.5*u*u);
+  }
+  for(int i = 1; i <= np; i++)
+  {
+    const double amplitude = sc[i]*p[5];
+    const double mean = p[2] + (i-1)*p[7];
+    for(int j = 0; j < nPoints; j++)
+    {
+      const double v = (x[j] - mean)*invWidth;
+      result[j] += amplitude*exp(-0.5*v*v);
+    }
+  }
+  const LandauTable& landau = LandauTable::instance();
+  for(int j = 0; j < nPoints; j++) result[j] += p[3]*landau.landau(x[j] - p[2] + 50, 0, p[4]);
+}
+
+//Integral of exp(-0.5((x-mean)/sigma)^2) over [a, b], from erfc on the tail side so that bins far
+//from the mean keep their relative precision
+inline double gausIntegral(const double a, const double b, const double mean, const double sigma)
+{
+  const double za = (a - mean)/(M_SQRT2*sigma);
+  const double zb = (b - mean)/(M_SQRT2*sigma);
+  double d;
+  if(za > 0)      d = std::erfc(za) - std::erfc(zb);
+  else if(zb < 0) d = std::erfc(-zb) - std::erfc(-za);
+  else            d = std::erf(zb) - std::erf(za);
+  return sigma*sqrt(M_PI/2)*d;
+}
+
+//Average of ppeKernel over the bin [as, bs] (x - p[2] at the bin edges), the Gaussians from erf
+//differences and the background from the tabulated Landau cumulative
+template<int NPeaks> double ppeBinKernel(const double as, const double bs, const double* p, const double* sc, const int nPeaks)
+{
+  const int np = NPeaks > 0 ? NPeaks : nPeaks;
+  double g = p[0]*gausIntegral(as, bs, 0, p[1]);
+  for(int i = 1; i <= np; i++) g += sc[i]*p[5]*gausIntegral(as, bs, (i-1)*p[7], p[8]);
+  g += p[3]*LandauTable::instance().landauIntegral(as + 50, bs + 50, 0, p[4]);
+  return g/(bs - as);
+}
+
 //Fit function for pedestal and photoelectron spectrum
 class PPEFunc
 {
+ public:
+  //How the pedestal, PE peaks and background are evaluated: Formula through the TF1s (the
+  //reference, which is not for use from several threads), Inline through ppeKernel, Unrolled
+  //through ppeKernel specialized for 3 or 6 peaks (Inline for other peak counts)
+  enum class Kernel { Formula, Inline, Unrolled };
+
+ private:
   //Paper on SiPM pixel crosstalk model
   //http://arxiv.org/pdf/1302.1455.pdf
   //n is the number of neighbor cells in the crosstalk model 
-  const double n = 4;
+  int n;
   bool domip_;
   //CPn are the constant combinatoric scale factors based on n
   std::vector <double> CPn;
 
-  //More ugly globals to hold utility functions used in fits
-  std::vector <TF1*> funcs;
-  TF1* funcMIP;
-  double nPeaks_; //Varable number of photoelectrons
-  double nTotalPeaks_ = 15; //Total number of possible photoelectrons for the fit 
+  //Utility functions of the Formula kernel, shared by the copies of the functor (one per TF1) and
+  //deleted with the last of them; they are not in the global list of functions
+  std::vector <std::shared_ptr<TF1>> funcs;
+  //Landau-Gauss MIP peak, evaluated by FFT over the histogram range
+  LangauFFT mip_;
+  Kernel kernel_;
+  double (*ppeKernel_)(double, const double*, const double*, int);
+  void (*ppeKernelBatch_)(const double*, int, const double*, const double*, int, double*);
+  double (*ppeBinKernel_)(double, double, const double*, const double*, int);
+  //bin edges for bin-integrated evaluation, empty for evaluation at x
+  std::vector<double> binEdges_;
+
+  //Edges [a, b] of the bin containing x, false if not bin-integrated or x is outside of the bins
+  bool findBin(const double x, double& a, double& b) const
+  {
+    const auto it = std::upper_bound(binEdges_.begin(), binEdges_.end(), x);
+    if(it == binEdges_.begin() || it == binEdges_.end()) return false;
+    a = *(it - 1);
+    b = *it;
+    return true;
+  }
+  int nPeaks_; //Varable number of photoelectrons
+  int nTotalPeaks_; //Total number of possible photoelectrons for the fit 
   
-  //s defines the poisson factor for each PE peak based upon the poisson mean PE p[5]
-  //in absense of cross-talk this would perfectly describe the PE peak amplitude ratios
-  std::vector <double> s;
+  //cp is the probability that one primary avalanche fires k cells in total,
+  //sc the probability of k fired cells from all primaries (Poisson of mean p[6] compounded with cp)
   std::vector <double> cp;
   std::vector <double> sc;
+  //derivatives of cp with respect to p[9] and of sc with respect to p[6] and p[9], for gradients
+  std::vector <double> dcp;
+  std::vector <double> dscMean;
+  std::vector <double> dscCT;
+
+  //p[6] and p[9] of the current cp and sc; every copy of the functor (one per TF1) keeps its own
+  bool coeffValid_ = false;
+  double coeffMean_ = 0;
+  double coeffCTProb_ = 0;
+
+  void computeCoefficients(const double mean, const double ctProb)
+  {
+    //cp[k] = CPn[k] ctProb^(k-1) (1 - ctProb)^(k n - (k-1)), built up by one multiplication per k
+    const double q = 1 - ctProb;
+    const double qStep = pow(q, n - 1);
+    double ctPow = 1;
+    double ctPowPrev = 0;
+    double qPow = q;
+    for(int k = 1; k <= nTotalPeaks_; ++k)
+    {
+      qPow *= qStep;
+      const int m = k*n - (k - 1);
+      cp[k] = CPn[k] * ctPow * qPow;
+      dcp[k] = CPn[k] * ((k - 1) * ctPowPrev * qPow - m * ctPow * qPow / q);
+      ctPowPrev = ctPow;
+      ctPow *= ctProb;
+    }
+
+    //Panjer recursion for the compound Poisson distribution, O(nTotalPeaks^2):
+    //sc[k] = mean/k sum_j j cp[j] sc[k-j], sc[0] = exp(-mean), differentiated term by term
+    sc[0] = exp(-mean);
+    dscMean[0] = -sc[0];
+    dscCT[0] = 0;
+    for(int k = 1; k <= nTotalPeaks_; ++k)
+    {
+      double sum = 0, sumMean = 0, sumCT = 0;
+      for(int j = 1; j <= k; ++j)
+      {
+        sum     += j * cp[j] * sc[k - j];
+        sumMean += j * cp[j] * dscMean[k - j];
+        sumCT   += j * (dcp[j] * sc[k - j] + cp[j] * dscCT[k - j]);
+      }
+      sc[k] = mean / k * sum;
+      dscMean[k] = (sum + mean * sumMean) / k;
+      dscCT[k] = mean / k * sumCT;
+    }
+  }
   
  public:
   TH1* h;
-  //Constructor
-  PPEFunc(int nPeak, bool domip) : s(nTotalPeaks_+1,0.0), cp(nTotalPeaks_+1,0.0), sc(nTotalPeaks_+1,0.0)
+  //Constructor, nNeighbours and nTotalPeaks set the crosstalk model (4 neighbours, 15 peaks by default)
+  PPEFunc(int nPeak, bool domip, int nNeighbours = 4, int nTotalPeaks = 15)
   {
+    h = nullptr;
+    n = nNeighbours;
     nPeaks_ = nPeak;
+    nTotalPeaks_ = std::max(nTotalPeaks, nPeak);
     domip_ = domip;
-    
-    CPn.push_back(0);
-    CPn.push_back(1);
-    CPn.push_back(n);
-    CPn.push_back((n*(-1 + 3*n))/2.);
-    CPn.push_back((n*(1 - 6*n + 8*pow(n,2)))/3.);
-    CPn.push_back((n*(-3 + 5*n)*(-2 + 5*n)*(-1 + 5*n))/24.);
-    CPn.push_back((n*(-1 + 2*n)*(-2 + 3*n)*(-1 + 3*n)*(-1 + 6*n))/10.);
-    CPn.push_back((n*(-5 + 7*n)*(-4 + 7*n)*(-3 + 7*n)*(-2 + 7*n)*(-1 + 7*n))/720.);
-    CPn.push_back((n*(-1 + 2*n)*(-3 + 4*n)*(-1 + 4*n)*(-5 + 8*n)*(-3 + 8*n)*(-1 + 8*n))/315.);
-    CPn.push_back((n*(-2 + 3*n)*(-1 + 3*n)*(-7 + 9*n)*(-5 + 9*n)*(-4 + 9*n)*(-2 + 9*n)*(-1 + 9*n))/4480.);
-    CPn.push_back((n*(-1 + 2*n)*(-4 + 5*n)*(-3 + 5*n)*(-2 + 5*n)*(-1 + 5*n)*(-7 + 10*n)*(-3 + 10*n)*(-1 + 10*n))/4536.);
-    CPn.push_back((n*(-9 + 11*n)*(-8 + 11*n)*(-7 + 11*n)*(-6 + 11*n)*(-5 + 11*n)*(-4 + 11*n)*(-3 + 11*n)*(-2 + 11*n)*(-1 + 11*n))/3.6288e6);
-    CPn.push_back((n*(-1 + 2*n)*(-2 + 3*n)*(-1 + 3*n)*(-3 + 4*n)*(-1 + 4*n)*(-5 + 6*n)*(-1 + 6*n)*(-7 + 12*n)*(-5 + 12*n)*(-1 + 12*n))/11550.);
-    CPn.push_back((n*(-11 + 13*n)*(-10 + 13*n)*(-9 + 13*n)*(-8 + 13*n)*(-7 + 13*n)*(-6 + 13*n)*(-5 + 13*n)*(-4 + 13*n)*(-3 + 13*n)*(-2 + 13*n)*(-1 + 13*n))/4.790016e8);
-    CPn.push_back((n*(-1 + 2*n)*(-6 + 7*n)*(-5 + 7*n)*(-4 + 7*n)*(-3 + 7*n)*(-2 + 7*n)*(-1 + 7*n)*(-11 + 14*n)*(-9 + 14*n)*(-5 + 14*n)*(-3 + 14*n)*(-1 + 14*n))/1.38996e7);
-    CPn.push_back((pow(n,2)*(19802759040 + n*(-425547472896 + n*(4895614496136 + n*(-36007056781696 + n*(180954419071426 + n*(-643524004371248 + n*(1648017660281993 + n*(-3051606955645248 + n*(4048835387589993 + n*(-3751975766595056 + n*(2305159936523171 + n*(-843351196289056 + 139013933454241*n)))))))))))))/6.2270208e9);
+    cp.assign(nTotalPeaks_+1, 0.0);
+    sc.assign(nTotalPeaks_+1, 0.0);
+    dcp.assign(nTotalPeaks_+1, 0.0);
+    dscMean.assign(nTotalPeaks_+1, 0.0);
+    dscCT.assign(nTotalPeaks_+1, 0.0);
+
+    //compile time tables for the common configurations
+    const double* table = nullptr;
+    if(nTotalPeaks_ <= crosstalkTablePeaks)
+    {
+      if(n == 4) table = crosstalkTable4.CPn;
+      if(n == 8) table = crosstalkTable8.CPn;
+    }
+    for(int k = 0; k <= nTotalPeaks_; k++)
+    {
+      if(k == 0)      CPn.push_back(0);
+      else if(table)  CPn.push_back(table[k]);
+      else            CPn.push_back(crosstalkCombinatorics(k, n));
+    }
   
-    //configure utility functions for fits
-    funcs.push_back(new TF1("ped", "gaus"));
+    setKernel(Kernel::Unrolled);
+  }
 
-    for(int i = 1; i <= nTotalPeaks_; i++)
+  //Select the kernel, e.g. per fit stage before the functor is copied into its TF1
+  void setKernel(const Kernel kernel)
+  {
+    kernel_ = kernel;
+    //the formula TF1s are only made for the reference kernel, the others keep no shared or global state
+    if(kernel == Kernel::Formula && funcs.empty())
     {
-	    //fill funcs
-	    std::string pnum = "pe" + std::to_string(i);
-	    funcs.push_back(new TF1(pnum.c_str(), "gaus"));
+      //configure utility functions for fits
+      funcs.emplace_back(new TF1("ped", "gaus", 0, 1, TF1::EAddToList::kNo));
+
+      for(int i = 1; i <= nTotalPeaks_; i++)
+      {
+        //fill funcs
+        std::string pnum = "pe" + std::to_string(i);
+        funcs.emplace_back(new TF1(pnum.c_str(), "gaus", 0, 1, TF1::EAddToList::kNo));
+      }
+
+      funcs.emplace_back(new TF1("bg",  "landau", 0, 1, TF1::EAddToList::kNo));
     }
-    
-    funcs.push_back(new TF1("bg",  "landau"));
-    funcMIP = new TF1("mip",  langaufun, 0, 400000, 4);
+    ppeKernel_ = &ppeKernel<0>;
+    ppeKernelBatch_ = &ppeKernelBatch<0>;
+    ppeBinKernel_ = &ppeBinKernel<0>;
+    if(kernel == Kernel::Unrolled && nPeaks_ == 3)
+    {
+      ppeKernel_ = &ppeKernel<3>;
+      ppeKernelBatch_ = &ppeKernelBatch<3>;
+      ppeBinKernel_ = &ppeBinKernel<3>;
+    }
+    if(kernel == Kernel::Unrolled && nPeaks_ == 6)
+    {
+      ppeKernel_ = &ppeKernel<6>;
+      ppeKernelBatch_ = &ppeKernelBatch<6>;
+      ppeBinKernel_ = &ppeBinKernel<6>;
+    }
+  }
 
+  //Evaluate the model as its average over the bin containing x instead of at x, for points inside
+  //the edges (bin-integrated kernels are closed form, the Formula kernel uses the Inline one)
+  void setBinEdges(const std::vector<double>& edges) { binEdges_ = edges; }
+
+  //Bin-integrated evaluation in the bins of hist
+  void setBinEdges(TH1* hist)
+  {
+    binEdges_.clear();
+    for(int i = 1; i <= hist->GetNbinsX() + 1; i++) binEdges_.push_back(hist->GetXaxis()->GetBinLowEdge(i));
   }
 
-  double ppeFunc(double* x, double* p)
+  //Back to evaluation at x
+  void clearBinEdges() { binEdges_.clear(); }
+
+  Kernel getKernel() const { return kernel_; }
+
+  //Parameter dependent part of ppeFunc, independent of x
+  void setPPEParameters(const double* p)
   {
     /*
       parameters
@@ -178,72 +396,46 @@ class PPEFunc
       p[9] : pixel cross-talk probability 
     */
 
-    for(int i = 1; i < nTotalPeaks_+1; ++i) s[i] = TMath::Poisson(i, p[6]);
-    //cp represents the binomial scale factors for each PE peak based upon the crosstalk probability p[9]
-    cp[1]  = CPn[1]  * pow(p[9], 0)  * pow(1 - p[9], 1*n  -  0);
-    cp[2]  = CPn[2]  * pow(p[9], 1)  * pow(1 - p[9], 2*n  -  1);
-    cp[3]  = CPn[3]  * pow(p[9], 2)  * pow(1 - p[9], 3*n  -  2);
-    cp[4]  = CPn[4]  * pow(p[9], 3)  * pow(1 - p[9], 4*n  -  3);
-    cp[5]  = CPn[5]  * pow(p[9], 4)  * pow(1 - p[9], 5*n  -  4);
-    cp[6]  = CPn[6]  * pow(p[9], 5)  * pow(1 - p[9], 6*n  -  5);
-    cp[7]  = CPn[7]  * pow(p[9], 6)  * pow(1 - p[9], 7*n  -  6);
-    cp[8]  = CPn[8]  * pow(p[9], 7)  * pow(1 - p[9], 8*n  -  7);
-    cp[9]  = CPn[9]  * pow(p[9], 8)  * pow(1 - p[9], 9*n  -  8);
-    cp[10] = CPn[10] * pow(p[9], 9)  * pow(1 - p[9], 10*n -  9);
-    cp[11] = CPn[11] * pow(p[9], 10) * pow(1 - p[9], 11*n - 10);
-    cp[12] = CPn[12] * pow(p[9], 11) * pow(1 - p[9], 12*n - 11);
-    cp[13] = CPn[13] * pow(p[9], 12) * pow(1 - p[9], 13*n - 12);
-    cp[14] = CPn[14] * pow(p[9], 13) * pow(1 - p[9], 14*n - 13);
-    cp[15] = CPn[15] * pow(p[9], 14) * pow(1 - p[9], 15*n - 14);
-    
-    //sc holds the convolution of of the poisson PE statistics factors s and binomial cross-talk factors cp 
-    sc[1] = 1*s[1]*cp[1];
-    sc[2] = 1*s[1]*cp[2] + 1*s[2]*cp[1]*cp[1];    
-    sc[3] = 2*s[2]*cp[1]*cp[2] + 1*s[3]*cp[1]*cp[1]*cp[1] + 1*s[1]*cp[3];    
-    sc[4] = 3*s[3]*cp[1]*cp[1]*cp[2] + 2*s[2]*cp[1]*cp[3] + 1*s[4]*cp[1]*cp[1]*cp[1]*cp[1] + 1*s[2]*cp[2]*cp[2] + 1*s[1]*cp[4];    
-    sc[5] = 3*s[3]*cp[1]*cp[1]*cp[3] + 2*s[2]*cp[1]*cp[4] + 3*s[3]*cp[1]*cp[2]*cp[2] + 1*s[1]*cp[5] + 2*s[2]*cp[2]*cp[3] + 4*s[4]*cp[1]*cp[1]*cp[1]*cp[2] + 1*s[5]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1];    
-    sc[6] = 1*s[3]*cp[2]*cp[2]*cp[2] + 1*s[2]*cp[3]*cp[3] + 6*s[4]*cp[1]*cp[1]*cp[2]*cp[2] + 5*s[5]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2] + 6*s[3]*cp[1]*cp[2]*cp[3] + 2*s[2]*cp[1]*cp[5] + 1*s[1]*cp[6] + 2*s[2]*cp[2]*cp[4] + 1*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1] + 3*s[3]*cp[1]*cp[1]*cp[4] + 4*s[4]*cp[1]*cp[1]*cp[1]*cp[3];
-    sc[7] = 1*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1] + 3*s[3]*cp[1]*cp[1]*cp[5] + 4*s[4]*cp[1]*cp[1]*cp[1]*cp[4] + 6*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2] + 5*s[5]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3] + 4*s[4]*cp[1]*cp[2]*cp[2]*cp[2] + 12*s[4]*cp[1]*cp[1]*cp[2]*cp[3] + 10*s[5]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2] + 2*s[2]*cp[1]*cp[6] + 6*s[3]*cp[1]*cp[2]*cp[4] + 1*s[1]*cp[7] + 2*s[2]*cp[2]*cp[5] + 2*s[2]*cp[3]*cp[4] + 3*s[3]*cp[2]*cp[2]*cp[3] + 3*s[3]*cp[1]*cp[3]*cp[3];    
-    sc[8] = 20*s[5]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3] + 3*s[3]*cp[2]*cp[3]*cp[3] + 3*s[3]*cp[1]*cp[1]*cp[6] + 3*s[3]*cp[2]*cp[2]*cp[4] + 15*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2] + 1*s[4]*cp[2]*cp[2]*cp[2]*cp[2] + 1*s[2]*cp[4]*cp[4] + 4*s[4]*cp[1]*cp[1]*cp[1]*cp[5] + 2*s[2]*cp[2]*cp[6] + 6*s[4]*cp[1]*cp[1]*cp[3]*cp[3] + 1*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1] + 1*s[1]*cp[8] + 7*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2] + 12*s[4]*cp[1]*cp[1]*cp[2]*cp[4] + 10*s[5]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2] + 6*s[3]*cp[1]*cp[2]*cp[5] + 2*s[2]*cp[3]*cp[5] + 2*s[2]*cp[1]*cp[7] + 5*s[5]*cp[1]*cp[1]*cp[1]*cp[1]*cp[4] + 6*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3] + 6*s[3]*cp[1]*cp[3]*cp[4] + 12*s[4]*cp[1]*cp[2]*cp[2]*cp[3];    
-    sc[9] = 3*s[3]*cp[1]*cp[1]*cp[7] + 5*s[5]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2] + 3*s[3]*cp[1]*cp[4]*cp[4] + 1*s[1]*cp[9] + 12*s[4]*cp[1]*cp[1]*cp[3]*cp[4] + 3*s[3]*cp[2]*cp[2]*cp[5] + 20*s[6]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2] + 1*s[3]*cp[3]*cp[3]*cp[3] + 8*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2] + 12*s[4]*cp[1]*cp[1]*cp[2]*cp[5] + 12*s[4]*cp[1]*cp[2]*cp[2]*cp[4] + 1*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1] + 30*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3] + 12*s[4]*cp[1]*cp[2]*cp[3]*cp[3] + 2*s[2]*cp[3]*cp[6] + 6*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[4] + 5*s[5]*cp[1]*cp[1]*cp[1]*cp[1]*cp[5] + 2*s[2]*cp[4]*cp[5] + 7*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3] + 30*s[5]*cp[1]*cp[1]*cp[2]*cp[2]*cp[3] + 4*s[4]*cp[1]*cp[1]*cp[1]*cp[6] + 2*s[2]*cp[2]*cp[7] + 6*s[3]*cp[1]*cp[2]*cp[6] + 20*s[5]*cp[1]*cp[1]*cp[1]*cp[2]*cp[4] + 21*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2] + 6*s[3]*cp[1]*cp[3]*cp[5] + 2*s[2]*cp[1]*cp[8] + 10*s[5]*cp[1]*cp[1]*cp[1]*cp[3]*cp[3] + 6*s[3]*cp[2]*cp[3]*cp[4] + 4*s[4]*cp[2]*cp[2]*cp[2]*cp[3];    
-    sc[10] = 6*s[3]*cp[2]*cp[3]*cp[5] + 4*s[4]*cp[1]*cp[1]*cp[1]*cp[7] + 9*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2] + 2*s[2]*cp[2]*cp[8] + 8*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3] + 6*s[3]*cp[1]*cp[4]*cp[5] + 1*s[10]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1] + 60*s[6]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[3] + 1*s[5]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2] + 15*s[6]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2] + 2*s[2]*cp[3]*cp[7] + 28*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2] + 20*s[5]*cp[1]*cp[1]*cp[1]*cp[2]*cp[5] + 4*s[4]*cp[1]*cp[3]*cp[3]*cp[3] + 30*s[5]*cp[1]*cp[1]*cp[2]*cp[3]*cp[3] + 1*s[2]*cp[5]*cp[5] + 3*s[3]*cp[1]*cp[1]*cp[8] + 7*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[4] + 3*s[3]*cp[3]*cp[3]*cp[4] + 12*s[4]*cp[1]*cp[1]*cp[3]*cp[5] + 3*s[3]*cp[2]*cp[4]*cp[4] + 15*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[3] + 30*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[4] + 6*s[4]*cp[2]*cp[2]*cp[3]*cp[3] + 20*s[5]*cp[1]*cp[2]*cp[2]*cp[2]*cp[3] + 12*s[4]*cp[1]*cp[2]*cp[2]*cp[5] + 2*s[2]*cp[1]*cp[9] + 4*s[4]*cp[2]*cp[2]*cp[2]*cp[4] + 6*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[5] + 2*s[2]*cp[4]*cp[6] + 35*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2] + 24*s[4]*cp[1]*cp[2]*cp[3]*cp[4] + 1*s[1]*cp[10] + 6*s[3]*cp[1]*cp[3]*cp[6] + 6*s[3]*cp[1]*cp[2]*cp[7] + 3*s[3]*cp[2]*cp[2]*cp[6] + 20*s[5]*cp[1]*cp[1]*cp[1]*cp[3]*cp[4] + 30*s[5]*cp[1]*cp[1]*cp[2]*cp[2]*cp[4] + 6*s[4]*cp[1]*cp[1]*cp[4]*cp[4] + 5*s[5]*cp[1]*cp[1]*cp[1]*cp[1]*cp[6] + 12*s[4]*cp[1]*cp[1]*cp[2]*cp[6] + 42*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3];    
-    sc[11] = 2*s[2]*cp[4]*cp[7] + 21*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[3] + 1*s[11]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1] + 2*s[2]*cp[5]*cp[6] + 12*s[4]*cp[2]*cp[2]*cp[3]*cp[4] + 42*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[4] + 6*s[3]*cp[1]*cp[2]*cp[8] + 10*s[5]*cp[1]*cp[1]*cp[3]*cp[3]*cp[3] + 1*s[1]*cp[11] + 20*s[5]*cp[1]*cp[2]*cp[2]*cp[2]*cp[4] + 60*s[5]*cp[1]*cp[1]*cp[2]*cp[3]*cp[4] + 8*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[4] + 30*s[5]*cp[1]*cp[1]*cp[2]*cp[2]*cp[5] + 3*s[3]*cp[1]*cp[1]*cp[9] + 60*s[6]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[3] + 2*s[2]*cp[2]*cp[9] + 10*s[10]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2] + 20*s[5]*cp[1]*cp[1]*cp[1]*cp[3]*cp[5] + 4*s[4]*cp[1]*cp[1]*cp[1]*cp[8] + 60*s[6]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[4] + 3*s[3]*cp[3]*cp[3]*cp[5] + 6*s[3]*cp[2]*cp[3]*cp[6] + 5*s[5]*cp[1]*cp[1]*cp[1]*cp[1]*cp[7] + 6*s[3]*cp[2]*cp[4]*cp[5] + 2*s[2]*cp[1]*cp[10] + 24*s[4]*cp[1]*cp[2]*cp[3]*cp[5] + 12*s[4]*cp[1]*cp[1]*cp[3]*cp[6] + 60*s[6]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3]*cp[3] + 30*s[5]*cp[1]*cp[2]*cp[2]*cp[3]*cp[3] + 7*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[5] + 12*s[4]*cp[1]*cp[3]*cp[3]*cp[4] + 5*s[5]*cp[2]*cp[2]*cp[2]*cp[2]*cp[3] + 36*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2] + 12*s[4]*cp[1]*cp[1]*cp[4]*cp[5] + 105*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[3] + 12*s[4]*cp[1]*cp[1]*cp[2]*cp[7] + 12*s[4]*cp[1]*cp[2]*cp[4]*cp[4] + 6*s[6]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2] + 3*s[3]*cp[1]*cp[5]*cp[5] + 56*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2] + 6*s[3]*cp[1]*cp[4]*cp[6] + 4*s[4]*cp[2]*cp[3]*cp[3]*cp[3] + 30*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[5] + 4*s[4]*cp[2]*cp[2]*cp[2]*cp[5] + 6*s[3]*cp[1]*cp[3]*cp[7] + 30*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[4] + 6*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[6] + 56*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3] + 9*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3] + 2*s[2]*cp[3]*cp[8] + 3*s[3]*cp[3]*cp[4]*cp[4] + 3*s[3]*cp[2]*cp[2]*cp[7] + 10*s[5]*cp[1]*cp[1]*cp[1]*cp[4]*cp[4] + 20*s[5]*cp[1]*cp[1]*cp[1]*cp[2]*cp[6] + 12*s[4]*cp[1]*cp[2]*cp[2]*cp[6] + 35*s[7]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2];
-    sc[12] = 42*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[4] + 6*s[3]*cp[1]*cp[4]*cp[7] + 12*s[4]*cp[1]*cp[3]*cp[4]*cp[4] + 3*s[3]*cp[2]*cp[5]*cp[5] + 30*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[5] + 168*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[3] + 1*s[2]*cp[6]*cp[6] + 6*s[3]*cp[1]*cp[2]*cp[9] + 72*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3] + 60*s[6]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[4] + 6*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[7] + 21*s[7]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2] + 6*s[3]*cp[2]*cp[3]*cp[7] + 42*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[5] + 60*s[5]*cp[1]*cp[2]*cp[2]*cp[3]*cp[4] + 3*s[3]*cp[3]*cp[3]*cp[6] + 20*s[6]*cp[1]*cp[1]*cp[1]*cp[3]*cp[3]*cp[3] + 10*s[5]*cp[2]*cp[2]*cp[2]*cp[3]*cp[3] + 60*s[6]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[5] + 1*s[3]*cp[4]*cp[4]*cp[4] + 1*s[4]*cp[3]*cp[3]*cp[3]*cp[3] + 105*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3]*cp[3] + 12*s[4]*cp[2]*cp[2]*cp[3]*cp[5] + 2*s[2]*cp[1]*cp[11] + 10*s[10]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3] + 70*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2] + 20*s[5]*cp[1]*cp[1]*cp[1]*cp[4]*cp[5] + 2*s[2]*cp[4]*cp[8] + 30*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[6] + 140*s[7]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[3] + 4*s[4]*cp[2]*cp[2]*cp[2]*cp[6] + 28*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[3] + 15*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[4]*cp[4] + 45*s[10]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2] + 3*s[3]*cp[2]*cp[2]*cp[8] + 56*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[4] + 1*s[6]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2] + 12*s[4]*cp[1]*cp[1]*cp[4]*cp[6] + 12*s[4]*cp[1]*cp[1]*cp[2]*cp[8] + 30*s[5]*cp[1]*cp[1]*cp[2]*cp[4]*cp[4] + 12*s[4]*cp[1]*cp[2]*cp[2]*cp[7] + 6*s[3]*cp[2]*cp[4]*cp[6] + 9*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[4] + 20*s[5]*cp[1]*cp[2]*cp[2]*cp[2]*cp[5] + 90*s[6]*cp[1]*cp[1]*cp[2]*cp[2]*cp[3]*cp[3] + 6*s[3]*cp[1]*cp[3]*cp[8] + 3*s[3]*cp[1]*cp[1]*cp[10] + 7*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[6] + 2*s[2]*cp[2]*cp[10] + 24*s[4]*cp[1]*cp[2]*cp[3]*cp[6] + 2*s[2]*cp[3]*cp[9] + 4*s[4]*cp[1]*cp[1]*cp[1]*cp[9] + 1*s[1]*cp[12] + 84*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2] + 12*s[4]*cp[2]*cp[3]*cp[3]*cp[4] + 6*s[4]*cp[2]*cp[2]*cp[4]*cp[4] + 20*s[5]*cp[1]*cp[1]*cp[1]*cp[2]*cp[7] + 1*s[12]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1] + 20*s[5]*cp[1]*cp[1]*cp[1]*cp[3]*cp[6] + 30*s[5]*cp[1]*cp[1]*cp[2]*cp[2]*cp[6] + 8*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[5] + 60*s[5]*cp[1]*cp[1]*cp[2]*cp[3]*cp[5] + 12*s[4]*cp[1]*cp[1]*cp[3]*cp[7] + 20*s[5]*cp[1]*cp[2]*cp[3]*cp[3]*cp[3] + 2*s[2]*cp[5]*cp[7] + 5*s[5]*cp[2]*cp[2]*cp[2]*cp[2]*cp[4] + 6*s[3]*cp[1]*cp[5]*cp[6] + 12*s[4]*cp[1]*cp[3]*cp[3]*cp[5] + 105*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[4] + 11*s[11]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2] + 120*s[6]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3]*cp[4] + 30*s[6]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2]*cp[3] + 30*s[5]*cp[1]*cp[1]*cp[3]*cp[3]*cp[4] + 6*s[3]*cp[3]*cp[4]*cp[5] + 24*s[4]*cp[1]*cp[2]*cp[4]*cp[5] + 5*s[5]*cp[1]*cp[1]*cp[1]*cp[1]*cp[8] + 6*s[4]*cp[1]*cp[1]*cp[5]*cp[5];    
-    sc[13] = 280*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[3] + 6*s[3]*cp[1]*cp[2]*cp[10] + 12*s[4]*cp[1]*cp[1]*cp[2]*cp[9] + 56*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[4] + 20*s[5]*cp[1]*cp[1]*cp[1]*cp[3]*cp[7] + 2*s[2]*cp[5]*cp[8] + 3*s[3]*cp[2]*cp[2]*cp[9] + 2*s[2]*cp[6]*cp[7] + 20*s[5]*cp[1]*cp[2]*cp[2]*cp[2]*cp[6] + 56*s[8]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2] + 5*s[5]*cp[1]*cp[1]*cp[1]*cp[1]*cp[9] + 42*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[5] + 30*s[5]*cp[1]*cp[2]*cp[2]*cp[4]*cp[4] + 72*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[4] + 30*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[4]*cp[5] + 36*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[3] + 6*s[3]*cp[2]*cp[3]*cp[8] + 105*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[5] + 2*s[2]*cp[1]*cp[12] + 6*s[3]*cp[1]*cp[5]*cp[7] + 2*s[2]*cp[2]*cp[11] + 12*s[4]*cp[2]*cp[3]*cp[4]*cp[4] + 12*s[4]*cp[1]*cp[2]*cp[5]*cp[5] + 42*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[6] + 60*s[5]*cp[1]*cp[2]*cp[2]*cp[3]*cp[5] + 24*s[4]*cp[1]*cp[2]*cp[3]*cp[7] + 30*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[7] + 11*s[11]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3] + 60*s[5]*cp[1]*cp[2]*cp[3]*cp[3]*cp[4] + 12*s[4]*cp[1]*cp[3]*cp[3]*cp[6] + 12*s[4]*cp[1]*cp[1]*cp[4]*cp[7] + 12*s[4]*cp[2]*cp[2]*cp[4]*cp[5] + 10*s[10]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[4] + 60*s[6]*cp[1]*cp[2]*cp[2]*cp[2]*cp[3]*cp[3] + 12*s[4]*cp[2]*cp[3]*cp[3]*cp[5] + 3*s[3]*cp[3]*cp[3]*cp[7] + 6*s[3]*cp[1]*cp[3]*cp[9] + 3*s[3]*cp[1]*cp[6]*cp[6] + 12*s[4]*cp[1]*cp[2]*cp[2]*cp[8] + 10*s[5]*cp[2]*cp[2]*cp[3]*cp[3]*cp[3] + 8*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[6] + 3*s[3]*cp[4]*cp[4]*cp[5] + 210*s[7]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[3]*cp[3] + 30*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[6] + 12*s[4]*cp[1]*cp[1]*cp[5]*cp[6] + 60*s[6]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[6] + 120*s[10]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2] + 20*s[5]*cp[1]*cp[1]*cp[1]*cp[4]*cp[6] + 126*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2] + 5*s[5]*cp[2]*cp[2]*cp[2]*cp[2]*cp[5] + 210*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3]*cp[4] + 4*s[4]*cp[2]*cp[2]*cp[2]*cp[7] + 140*s[7]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[4] + 9*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[5] + 12*s[4]*cp[1]*cp[1]*cp[3]*cp[8] + 2*s[2]*cp[3]*cp[10] + 12*s[12]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2] + 7*s[7]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2] + 30*s[5]*cp[1]*cp[1]*cp[2]*cp[2]*cp[7] + 168*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3]*cp[3] + 5*s[5]*cp[1]*cp[3]*cp[3]*cp[3]*cp[3] + 6*s[6]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2]*cp[3] + 6*s[3]*cp[2]*cp[5]*cp[6] + 60*s[6]*cp[1]*cp[1]*cp[2]*cp[3]*cp[3]*cp[3] + 120*s[6]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3]*cp[5] + 60*s[6]*cp[1]*cp[1]*cp[1]*cp[3]*cp[3]*cp[4] + 105*s[7]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2]*cp[3] + 4*s[4]*cp[1]*cp[4]*cp[4]*cp[4] + 4*s[4]*cp[3]*cp[3]*cp[3]*cp[4] + 10*s[5]*cp[1]*cp[1]*cp[1]*cp[5]*cp[5] + 20*s[5]*cp[1]*cp[1]*cp[1]*cp[2]*cp[8] + 1*s[13]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1] + 60*s[5]*cp[1]*cp[1]*cp[2]*cp[4]*cp[5] + 56*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[5] + 12*s[4]*cp[2]*cp[2]*cp[3]*cp[6] + 6*s[3]*cp[3]*cp[4]*cp[6] + 30*s[5]*cp[1]*cp[1]*cp[3]*cp[4]*cp[4] + 24*s[4]*cp[1]*cp[2]*cp[4]*cp[6] + 1*s[1]*cp[13] + 60*s[6]*cp[1]*cp[1]*cp[1]*cp[2]*cp[4]*cp[4] + 24*s[4]*cp[1]*cp[3]*cp[4]*cp[5] + 30*s[5]*cp[1]*cp[1]*cp[3]*cp[3]*cp[5] + 168*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[4] + 2*s[2]*cp[4]*cp[9] + 30*s[6]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2]*cp[4] + 60*s[6]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[5] + 60*s[5]*cp[1]*cp[1]*cp[2]*cp[3]*cp[6] + 3*s[3]*cp[1]*cp[1]*cp[11] + 7*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[7] + 6*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[8] + 6*s[3]*cp[2]*cp[4]*cp[7] + 55*s[11]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2] + 21*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[4]*cp[4] + 35*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[3]*cp[3] + 252*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[3] + 90*s[10]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3] + 6*s[3]*cp[1]*cp[4]*cp[8] + 180*s[6]*cp[1]*cp[1]*cp[2]*cp[2]*cp[3]*cp[4] + 4*s[4]*cp[1]*cp[1]*cp[1]*cp[10] + 3*s[3]*cp[3]*cp[5]*cp[5] + 20*s[5]*cp[2]*cp[2]*cp[2]*cp[3]*cp[4];
-    sc[14] = 8*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[7] + 110*s[11]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3] + 42*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[7] + 12*s[4]*cp[1]*cp[1]*cp[4]*cp[8] + 12*s[4]*cp[1]*cp[4]*cp[4]*cp[5] + 4*s[4]*cp[3]*cp[3]*cp[3]*cp[5] + 20*s[5]*cp[1]*cp[1]*cp[1]*cp[3]*cp[8] + 45*s[10]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[3] + 420*s[7]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[3]*cp[4] + 12*s[4]*cp[2]*cp[2]*cp[3]*cp[7] + 24*s[4]*cp[1]*cp[2]*cp[4]*cp[7] + 90*s[6]*cp[1]*cp[1]*cp[2]*cp[2]*cp[4]*cp[4] + 6*s[4]*cp[2]*cp[2]*cp[5]*cp[5] + 2*s[2]*cp[4]*cp[10] + 20*s[5]*cp[2]*cp[2]*cp[2]*cp[3]*cp[5] + 1*s[7]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2] + 6*s[4]*cp[3]*cp[3]*cp[4]*cp[4] + 105*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[3]*cp[4] + 168*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[5] + 6*s[3]*cp[2]*cp[5]*cp[7] + 2*s[2]*cp[6]*cp[8] + 105*s[7]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2]*cp[4] + 6*s[3]*cp[2]*cp[4]*cp[8] + 60*s[6]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[7] + 210*s[10]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2] + 72*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[4] + 6*s[6]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2]*cp[4] + 20*s[5]*cp[1]*cp[2]*cp[2]*cp[2]*cp[7] + 30*s[5]*cp[1]*cp[1]*cp[3]*cp[3]*cp[6] + 7*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[8] + 6*s[3]*cp[3]*cp[4]*cp[7] + 4*s[4]*cp[2]*cp[2]*cp[2]*cp[8] + 60*s[5]*cp[1]*cp[2]*cp[2]*cp[4]*cp[5] + 140*s[7]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3]*cp[3]*cp[3] + 2*s[2]*cp[2]*cp[12] + 15*s[6]*cp[1]*cp[1]*cp[3]*cp[3]*cp[3]*cp[3] + 210*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3]*cp[5] + 66*s[12]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2] + 12*s[4]*cp[1]*cp[3]*cp[5]*cp[5] + 24*s[4]*cp[2]*cp[3]*cp[4]*cp[5] + 15*s[6]*cp[2]*cp[2]*cp[2]*cp[2]*cp[3]*cp[3] + 140*s[7]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[5] + 12*s[4]*cp[2]*cp[3]*cp[3]*cp[6] + 6*s[4]*cp[1]*cp[1]*cp[6]*cp[6] + 42*s[7]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2]*cp[3] + 60*s[6]*cp[1]*cp[1]*cp[1]*cp[3]*cp[4]*cp[4] + 1*s[2]*cp[7]*cp[7] + 4*s[4]*cp[2]*cp[4]*cp[4]*cp[4] + 10*s[10]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[5] + 12*s[4]*cp[1]*cp[2]*cp[2]*cp[9] + 72*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[5] + 30*s[5]*cp[2]*cp[2]*cp[3]*cp[3]*cp[4] + 3*s[3]*cp[1]*cp[1]*cp[12] + 120*s[6]*cp[1]*cp[2]*cp[2]*cp[2]*cp[3]*cp[4] + 30*s[5]*cp[1]*cp[1]*cp[2]*cp[5]*cp[5] + 28*s[8]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2] + 28*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[4]*cp[4] + 9*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[6] + 56*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[6] + 30*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[7] + 60*s[5]*cp[1]*cp[2]*cp[3]*cp[3]*cp[5] + 60*s[6]*cp[1]*cp[2]*cp[2]*cp[3]*cp[3]*cp[3] + 24*s[4]*cp[1]*cp[2]*cp[5]*cp[6] + 10*s[5]*cp[1]*cp[1]*cp[4]*cp[4]*cp[4] + 336*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3]*cp[4] + 105*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[6] + 24*s[4]*cp[1]*cp[3]*cp[4]*cp[6] + 6*s[3]*cp[1]*cp[4]*cp[9] + 6*s[3]*cp[3]*cp[5]*cp[6] + 1*s[14]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1] + 20*s[5]*cp[1]*cp[3]*cp[3]*cp[3]*cp[4] + 13*s[13]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2] + 180*s[6]*cp[1]*cp[1]*cp[2]*cp[3]*cp[3]*cp[4] + 5*s[5]*cp[1]*cp[1]*cp[1]*cp[1]*cp[10] + 60*s[5]*cp[1]*cp[2]*cp[3]*cp[4]*cp[4] + 6*s[3]*cp[1]*cp[2]*cp[11] + 30*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[8] + 165*s[11]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2] + 20*s[5]*cp[1]*cp[1]*cp[1]*cp[2]*cp[9] + 3*s[3]*cp[2]*cp[6]*cp[6] + 60*s[5]*cp[1]*cp[1]*cp[2]*cp[4]*cp[6] + 252*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[4] + 56*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[5] + 5*s[5]*cp[2]*cp[2]*cp[2]*cp[2]*cp[6] + 24*s[4]*cp[1]*cp[2]*cp[3]*cp[8] + 12*s[4]*cp[1]*cp[3]*cp[3]*cp[7] + 6*s[3]*cp[1]*cp[5]*cp[8] + 60*s[6]*cp[1]*cp[1]*cp[1]*cp[3]*cp[3]*cp[5] + 280*s[8]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2]*cp[3] + 360*s[10]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[3] + 2*s[2]*cp[3]*cp[11] + 20*s[5]*cp[1]*cp[1]*cp[1]*cp[4]*cp[7] + 42*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[4]*cp[5] + 11*s[11]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[4] + 105*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[4]*cp[4] + 6*s[3]*cp[2]*cp[3]*cp[9] + 60*s[5]*cp[1]*cp[2]*cp[2]*cp[3]*cp[6] + 12*s[4]*cp[1]*cp[1]*cp[2]*cp[10] + 120*s[6]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3]*cp[6] + 252*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3]*cp[3] + 30*s[5]*cp[1]*cp[1]*cp[2]*cp[2]*cp[8] + 2*s[2]*cp[5]*cp[9] + 504*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[3] + 120*s[6]*cp[1]*cp[1]*cp[1]*cp[2]*cp[4]*cp[5] + 6*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[9] + 56*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[3]*cp[3] + 30*s[6]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2]*cp[5] + 10*s[5]*cp[2]*cp[2]*cp[2]*cp[4]*cp[4] + 42*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[6] + 90*s[10]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[4] + 280*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[4] + 4*s[4]*cp[1]*cp[1]*cp[1]*cp[11] + 3*s[3]*cp[2]*cp[2]*cp[10] + 20*s[5]*cp[1]*cp[1]*cp[1]*cp[5]*cp[6] + 210*s[7]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[3]*cp[3] + 60*s[6]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[6] + 6*s[3]*cp[1]*cp[3]*cp[10] + 15*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[5]*cp[5] + 420*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[3]*cp[3] + 12*s[12]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3] + 2*s[2]*cp[1]*cp[13] + 60*s[5]*cp[1]*cp[1]*cp[3]*cp[4]*cp[5] + 12*s[4]*cp[1]*cp[1]*cp[3]*cp[9] + 3*s[3]*cp[3]*cp[3]*cp[8] + 5*s[5]*cp[2]*cp[3]*cp[3]*cp[3]*cp[3] + 3*s[3]*cp[4]*cp[5]*cp[5] + 6*s[3]*cp[1]*cp[6]*cp[7] + 180*s[6]*cp[1]*cp[1]*cp[2]*cp[2]*cp[3]*cp[5] + 126*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2] + 1*s[1]*cp[14] + 3*s[3]*cp[4]*cp[4]*cp[6] + 12*s[4]*cp[1]*cp[1]*cp[5]*cp[7] + 60*s[5]*cp[1]*cp[1]*cp[2]*cp[3]*cp[7] + 12*s[4]*cp[2]*cp[2]*cp[4]*cp[6] + 30*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[4]*cp[6];
-    sc[15] = 20*s[5]*cp[1]*cp[1]*cp[1]*cp[2]*cp[10] + 2*s[2]*cp[6]*cp[9] + 12*s[4]*cp[1]*cp[1]*cp[6]*cp[7] + 168*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[4]*cp[4] + 4*s[4]*cp[3]*cp[4]*cp[4]*cp[4] + 12*s[4]*cp[2]*cp[3]*cp[3]*cp[7] + 60*s[6]*cp[1]*cp[1]*cp[1]*cp[2]*cp[5]*cp[5] + 12*s[4]*cp[2]*cp[4]*cp[4]*cp[5] + 210*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3]*cp[6] + 1*s[5]*cp[3]*cp[3]*cp[3]*cp[3]*cp[3] + 4*s[4]*cp[3]*cp[3]*cp[3]*cp[6] + 11*s[11]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[5] + 12*s[4]*cp[1]*cp[2]*cp[2]*cp[10] + 1*s[1]*cp[15] + 6*s[3]*cp[2]*cp[6]*cp[7] + 90*s[10]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[5] + 12*s[4]*cp[1]*cp[2]*cp[6]*cp[6] + 1*s[3]*cp[5]*cp[5]*cp[5] + 10*s[10]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[6] + 30*s[5]*cp[1]*cp[1]*cp[3]*cp[3]*cp[7] + 30*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[5]*cp[6] + 6*s[3]*cp[1]*cp[5]*cp[9] + 12*s[4]*cp[2]*cp[2]*cp[5]*cp[6] + 20*s[5]*cp[2]*cp[2]*cp[2]*cp[4]*cp[5] + 20*s[5]*cp[1]*cp[3]*cp[3]*cp[3]*cp[5] + 84*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[3]*cp[3] + 24*s[4]*cp[1]*cp[3]*cp[4]*cp[7] + 180*s[6]*cp[1]*cp[1]*cp[2]*cp[2]*cp[4]*cp[5] + 4*s[4]*cp[1]*cp[1]*cp[1]*cp[12] + 30*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[8] + 60*s[6]*cp[1]*cp[2]*cp[2]*cp[2]*cp[4]*cp[4] + 30*s[5]*cp[1]*cp[3]*cp[3]*cp[4]*cp[4] + 55*s[11]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[3] + 42*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[7] + 2*s[2]*cp[3]*cp[12] + 756*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[3]*cp[3] + 840*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[3]*cp[4] + 6*s[3]*cp[2]*cp[3]*cp[10] + 20*s[6]*cp[1]*cp[1]*cp[1]*cp[4]*cp[4]*cp[4] + 30*s[5]*cp[1]*cp[1]*cp[3]*cp[5]*cp[5] + 140*s[7]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[6] + 12*s[4]*cp[1]*cp[4]*cp[5]*cp[5] + 220*s[12]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2] + 60*s[6]*cp[1]*cp[1]*cp[3]*cp[3]*cp[3]*cp[4] + 30*s[5]*cp[2]*cp[2]*cp[3]*cp[3]*cp[5] + 60*s[6]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[8] + 504*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3]*cp[4] + 105*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[7] + 105*s[7]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2]*cp[3]*cp[3] + 12*s[12]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[4] + 36*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[4]*cp[4] + 105*s[7]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2]*cp[5] + 30*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[4]*cp[7] + 110*s[11]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[4] + 24*s[4]*cp[1]*cp[2]*cp[3]*cp[9] + 6*s[3]*cp[1]*cp[6]*cp[8] + 30*s[5]*cp[1]*cp[1]*cp[4]*cp[4]*cp[5] + 3*s[3]*cp[2]*cp[2]*cp[11] + 24*s[4]*cp[1]*cp[3]*cp[5]*cp[6] + 60*s[6]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[7] + 3*s[3]*cp[3]*cp[6]*cp[6] + 6*s[3]*cp[1]*cp[2]*cp[12] + 6*s[3]*cp[1]*cp[3]*cp[11] + 12*s[4]*cp[1]*cp[4]*cp[4]*cp[6] + 20*s[5]*cp[1]*cp[2]*cp[2]*cp[2]*cp[8] + 120*s[5]*cp[1]*cp[2]*cp[3]*cp[4]*cp[5] + 12*s[4]*cp[1]*cp[1]*cp[2]*cp[11] + 90*s[10]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[4] + 24*s[4]*cp[1]*cp[2]*cp[4]*cp[8] + 5*s[5]*cp[1]*cp[1]*cp[1]*cp[1]*cp[11] + 3*s[3]*cp[3]*cp[3]*cp[9] + 210*s[7]*cp[1]*cp[1]*cp[2]*cp[2]*cp[3]*cp[3]*cp[3] + 105*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[3]*cp[5] + 120*s[6]*cp[1]*cp[1]*cp[1]*cp[2]*cp[4]*cp[6] + 42*s[7]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2]*cp[4] + 42*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[4]*cp[6] + 3*s[3]*cp[4]*cp[4]*cp[7] + 6*s[3]*cp[4]*cp[5]*cp[6] + 252*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[5] + 2*s[2]*cp[4]*cp[11] + 120*s[6]*cp[1]*cp[2]*cp[2]*cp[2]*cp[3]*cp[5] + 2*s[2]*cp[5]*cp[10] + 630*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2]*cp[3] + 7*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[9] + 2*s[2]*cp[7]*cp[8] + 280*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[5] + 5*s[5]*cp[2]*cp[2]*cp[2]*cp[2]*cp[7] + 180*s[6]*cp[1]*cp[1]*cp[2]*cp[3]*cp[4]*cp[4] + 12*s[4]*cp[1]*cp[1]*cp[3]*cp[10] + 280*s[8]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2]*cp[4] + 105*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[4]*cp[4] + 12*s[4]*cp[1]*cp[1]*cp[5]*cp[8] + 132*s[12]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3] + 336*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3]*cp[5] + 6*s[3]*cp[2]*cp[5]*cp[8] + 9*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[7] + 60*s[5]*cp[1]*cp[2]*cp[2]*cp[3]*cp[7] + 24*s[4]*cp[2]*cp[3]*cp[4]*cp[6] + 20*s[6]*cp[2]*cp[2]*cp[2]*cp[3]*cp[3]*cp[3] + 180*s[6]*cp[1]*cp[1]*cp[2]*cp[3]*cp[3]*cp[5] + 24*s[4]*cp[1]*cp[2]*cp[5]*cp[7] + 60*s[5]*cp[1]*cp[2]*cp[3]*cp[3]*cp[6] + 2*s[2]*cp[1]*cp[14] + 280*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3]*cp[3]*cp[3] + 840*s[10]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[3] + 2*s[2]*cp[2]*cp[13] + 30*s[5]*cp[1]*cp[1]*cp[2]*cp[2]*cp[9] + 3*s[3]*cp[1]*cp[7]*cp[7] + 21*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[5]*cp[5] + 30*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[9] + 495*s[11]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[3] + 420*s[7]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[3]*cp[4] + 84*s[9]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2] + 78*s[13]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2] + 12*s[4]*cp[2]*cp[2]*cp[4]*cp[7] + 60*s[5]*cp[1]*cp[1]*cp[2]*cp[4]*cp[7] + 30*s[6]*cp[1]*cp[2]*cp[3]*cp[3]*cp[3]*cp[3] + 360*s[10]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[4] + 6*s[3]*cp[2]*cp[4]*cp[9] + 12*s[4]*cp[1]*cp[1]*cp[4]*cp[9] + 168*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[3]*cp[4] + 168*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[6] + 210*s[7]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[4]*cp[4] + 20*s[5]*cp[2]*cp[2]*cp[2]*cp[3]*cp[6] + 1*s[15]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1] + 30*s[6]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2]*cp[6] + 72*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[6] + 30*s[6]*cp[2]*cp[2]*cp[2]*cp[2]*cp[3]*cp[4] + 13*s[13]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3] + 42*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[8] + 12*s[4]*cp[2]*cp[3]*cp[5]*cp[5] + 8*s[8]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2] + 12*s[4]*cp[2]*cp[2]*cp[3]*cp[8] + 360*s[10]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3]*cp[3] + 120*s[6]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3]*cp[7] + 60*s[6]*cp[1]*cp[1]*cp[1]*cp[3]*cp[3]*cp[6] + 560*s[8]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[3]*cp[3] + 20*s[5]*cp[1]*cp[2]*cp[4]*cp[4]*cp[4] + 20*s[5]*cp[1]*cp[1]*cp[1]*cp[4]*cp[8] + 330*s[11]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2] + 60*s[5]*cp[1]*cp[1]*cp[3]*cp[4]*cp[6] + 504*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[4] + 12*s[4]*cp[3]*cp[3]*cp[4]*cp[5] + 168*s[8]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2]*cp[3] + 56*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[4]*cp[5] + 60*s[5]*cp[1]*cp[2]*cp[2]*cp[4]*cp[6] + 56*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[7] + 72*s[9]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[5] + 10*s[5]*cp[1]*cp[1]*cp[1]*cp[6]*cp[6] + 3*s[3]*cp[1]*cp[1]*cp[13] + 180*s[6]*cp[1]*cp[1]*cp[2]*cp[2]*cp[3]*cp[6] + 8*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[8] + 6*s[3]*cp[3]*cp[4]*cp[8] + 252*s[10]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2] + 30*s[5]*cp[1]*cp[2]*cp[2]*cp[5]*cp[5] + 420*s[7]*cp[1]*cp[1]*cp[1]*cp[2]*cp[2]*cp[3]*cp[5] + 20*s[5]*cp[1]*cp[1]*cp[1]*cp[3]*cp[9] + 6*s[6]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[10] + 20*s[5]*cp[2]*cp[3]*cp[3]*cp[3]*cp[4] + 56*s[8]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[3]*cp[6] + 35*s[7]*cp[1]*cp[1]*cp[1]*cp[3]*cp[3]*cp[3]*cp[3] + 14*s[14]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2] + 210*s[7]*cp[1]*cp[1]*cp[1]*cp[1]*cp[2]*cp[4]*cp[5] + 6*s[3]*cp[1]*cp[4]*cp[10] + 30*s[5]*cp[2]*cp[2]*cp[3]*cp[4]*cp[4] + 4*s[4]*cp[2]*cp[2]*cp[2]*cp[9] + 120*s[6]*cp[1]*cp[1]*cp[1]*cp[3]*cp[4]*cp[5] + 6*s[6]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2]*cp[5] + 12*s[4]*cp[1]*cp[3]*cp[3]*cp[8] + 6*s[3]*cp[3]*cp[5]*cp[7] + 60*s[5]*cp[1]*cp[1]*cp[2]*cp[5]*cp[6] + 420*s[7]*cp[1]*cp[1]*cp[1]*cp[2]*cp[3]*cp[3]*cp[4] + 7*s[7]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2]*cp[2]*cp[3] + 60*s[5]*cp[1]*cp[1]*cp[2]*cp[3]*cp[8] + 180*s[6]*cp[1]*cp[2]*cp[2]*cp[3]*cp[3]*cp[4] + 20*s[5]*cp[1]*cp[1]*cp[1]*cp[5]*cp[7];
-    
+    //the peak amplitudes only depend on p[6] and p[9], which most minimizer steps leave unchanged
+    if(!coeffValid_ || p[6] != coeffMean_ || p[9] != coeffCTProb_)
+    {
+      computeCoefficients(p[6], p[9]);
+      coeffMean_ = p[6];
+      coeffCTProb_ = p[9];
+      coeffValid_ = true;
+    }
+
+    if(kernel_ != Kernel::Formula) return;
+
     //Utility functions used parameterize the pedestal, PE peaks, and generic background 
-    int i;
     funcs[0]->SetParameters(p[0],    0.0, p[1]);
-    for(i = 1; i < nPeaks_+1; i++)
+    for(int i = 1; i < nPeaks_+1; i++)
     {
       funcs[i]->SetParameters(p[5],  (i-1)*p[7], p[8]);
     }
-    funcs[16]->SetParameters(p[3],    0.0, p[4]);
-    
-    //find bin edges
-    int iBin = h->FindBin(x[0]-p[2]);
-    double ll = h->GetBinLowEdge(iBin);
-    double ul = ll + h->GetBinWidth(iBin);
+    funcs[nTotalPeaks_+1]->SetParameters(p[3],    0.0, p[4]);
+  }
+
+  //ppeFunc at x for the parameters of the last setPPEParameters call
+  double evalPPE(const double x, const double* p) const
+  {
+    double a, b;
+    if(findBin(x, a, b)) return ppeBinKernel_(a-p[2], b-p[2], p, sc.data(), nPeaks_);
+    if(kernel_ != Kernel::Formula) return ppeKernel_(x-p[2], p, sc.data(), nPeaks_);
 
     //calculate contribution to bin of interest from each sub-function
-    //double g = funcs[0]->Integral(ll, ul)/(ul - ll);
-    double g = funcs[0]->Eval(x[0]-p[2]);
-    for(i = 1; i < nPeaks_+1; i++)
+    double g = funcs[0]->Eval(x-p[2]);
+    for(int i = 1; i < nPeaks_+1; i++)
     {
-      //std::string gnum = "g" + std::to_string(i);
-      //g += sc[i] * funcs[i]->Integral(ll, ul)/(ul - ll);
-      g += sc[i] * funcs[i]->Eval(x[0]-p[2]);
+      g += sc[i] * funcs[i]->Eval(x-p[2]);
     }
-    //g += funcs[i]->Integral(ll, ul)/(ul - ll);
-    g += funcs[16]->Eval(x[0]-p[2]+50);
+    g += funcs[nTotalPeaks_+1]->Eval(x-p[2]+50);
     
     return g;
   }
-  
-  //Functional fit for pedestal plus landgauss MIP peak
-  double mipFunc(double* x, double* p)
+
+  //Parameter dependent part of mipFunc
+  void setMIPParameters(const double* p)
   {
     /*
       parameters
@@ -253,24 +445,195 @@ class PPEFunc
       p[12] : Landau width parameter
       p[13] : gaussian width 
     */
+    const double mipPar[4] = {p[12], p[11], p[10], p[13]};
+    if(h) mip_.setRange(h->GetXaxis()->GetXmin() - p[2], h->GetXaxis()->GetXmax() - p[2]);
+    mip_.setParameters(mipPar);
+  }
 
-    //find bin edges
-    int iBin = h->FindBin(x[0]);;
-    double ll = h->GetBinLowEdge(iBin);
-    double ul = ll + h->GetBinWidth(iBin);
+  //mipFunc at x for the parameters of the last setMIPParameters call
+  double evalMIP(const double x, const double* p)
+  {
+    double a, b;
+    if(findBin(x, a, b)) return mip_.integral(a-p[2], b-p[2])/(b - a);
+    return mip_.eval(x-p[2]);
+  }
 
-    //calculate pedestal, photoelectron, and background contribution
-    //double ppe = ppeFunc(x, p);
+  //Number of parameters of the model
+  int getNPar() const { return domip_ ? 14 : 10; }
 
-    //set mip parameters
-    funcMIP->SetParameters(p[12], p[11], p[10], p[13]);
-    
-    //calculate MIP peak contribution
-    //double mip = funcMIP->Integral(ll, ul)/(ul - ll);
-    double mip = funcMIP->Eval(x[0]-p[2]);
-    //return bin value
-    //return ppe + mip;
-    return mip;
+  //Model at x and its derivatives with respect to all getNPar() parameters in grad
+  double gradient(const double x, const double* p, double* grad)
+  {
+    setPPEParameters(p);
+    double a, b;
+    if(findBin(x, a, b)) return binGradient(a, b, p, grad);
+    const double xs = x - p[2];
+
+    //pedestal, "gaus" is not normalized
+    const double u = xs/p[1];
+    const double pedShape = exp(-0.5*u*u);
+    double g = p[0]*pedShape;
+    grad[0] = pedShape;
+    grad[1] = p[0]*pedShape*u*u/p[1];
+    grad[2] = p[0]*pedShape*u/p[1];
+
+    //PE peaks, the amplitudes depend on p[6] and p[9] through sc
+    grad[5] = grad[6] = grad[7] = grad[8] = grad[9] = 0;
+    for(int i = 1; i < nPeaks_+1; i++)
+    {
+      const double v = (xs - (i-1)*p[7])/p[8];
+      const double shape = exp(-0.5*v*v);
+      const double peak = sc[i]*p[5]*shape;
+      g += peak;
+      grad[2] += peak*v/p[8];
+      grad[5] += sc[i]*shape;
+      grad[6] += dscMean[i]*p[5]*shape;
+      grad[7] += peak*v*(i-1)/p[8];
+      grad[8] += peak*v*v/p[8];
+      grad[9] += dscCT[i]*p[5]*shape;
+    }
+
+    //background, "landau" is not normalized either
+    grad[3] = grad[4] = 0;
+    if(p[4] > 0)
+    {
+      const double l = (xs + 50)/p[4];
+      double dDensity;
+      const double density = LandauTable::instance().density(l, dDensity);
+      g += p[3]*density;
+      grad[2] -= p[3]*dDensity/p[4];
+      grad[3] = density;
+      grad[4] = -p[3]*dDensity*l/p[4];
+    }
+
+    if(domip_)
+    {
+      setMIPParameters(p);
+      double dWidth, dMPV, dSigma;
+      const double f = mip_.evalUnitGradient(xs, dWidth, dMPV, dSigma);
+      g += p[10]*f;
+      grad[2]  += p[10]*dMPV;
+      grad[10]  = f;
+      grad[11]  = p[10]*dMPV;
+      grad[12]  = p[10]*dWidth;
+      grad[13]  = p[10]*dSigma;
+    }
+
+    return g;
+  }
+
+  //gradient for the average over the bin [a, b]; the Gaussian derivatives integrate to their values
+  //at the edges, those of the Landau to the density at the edges and the cumulative
+  double binGradient(const double a, const double b, const double* p, double* grad)
+  {
+    const double w = b - a;
+    const double as = a - p[2];
+    const double bs = b - p[2];
+
+    //pedestal
+    double ua = as/p[1], ub = bs/p[1];
+    double ga = exp(-0.5*ua*ua), gb = exp(-0.5*ub*ub);
+    const double pedShape = gausIntegral(as, bs, 0, p[1])/w;
+    double g = p[0]*pedShape;
+    grad[0] = pedShape;
+    grad[1] = p[0]*(ua*ga - ub*gb)/w + p[0]*pedShape/p[1];
+    grad[2] = p[0]*(ga - gb)/w;
+
+    //PE peaks
+    grad[5] = grad[6] = grad[7] = grad[8] = grad[9] = 0;
+    for(int i = 1; i < nPeaks_+1; i++)
+    {
+      const double mean = (i-1)*p[7];
+      ua = (as - mean)/p[8];
+      ub = (bs - mean)/p[8];
+      ga = exp(-0.5*ua*ua);
+      gb = exp(-0.5*ub*ub);
+      const double shape = gausIntegral(as, bs, mean, p[8])/w;
+      const double amplitude = sc[i]*p[5];
+      g += amplitude*shape;
+      grad[2] += amplitude*(ga - gb)/w;
+      grad[5] += sc[i]*shape;
+      grad[6] += dscMean[i]*p[5]*shape;
+      grad[7] += amplitude*(ga - gb)*(i-1)/w;
+      grad[8] += amplitude*(ua*ga - ub*gb)/w + amplitude*shape/p[8];
+      grad[9] += dscCT[i]*p[5]*shape;
+    }
+
+    //background
+    grad[3] = grad[4] = 0;
+    if(p[4] > 0)
+    {
+      const LandauTable& landau = LandauTable::instance();
+      const double la = (as + 50)/p[4], lb = (bs + 50)/p[4];
+      const double cumulative = landau.densityIntegral(la, lb);
+      const double da = landau.density(la), db = landau.density(lb);
+      g += p[3]*p[4]*cumulative/w;
+      grad[2] += p[3]*(da - db)/w;
+      grad[3] = p[4]*cumulative/w;
+      grad[4] = p[3]*(cumulative + la*da - lb*db)/w;
+    }
+
+    if(domip_)
+    {
+      setMIPParameters(p);
+      double dWidth, dMPV, dSigma;
+      const double f = mip_.integralUnitGradient(as, bs, dWidth, dMPV, dSigma)/w;
+      g += p[10]*f;
+      grad[2]  += p[10]*dMPV/w;
+      grad[10]  = f;
+      grad[11]  = p[10]*dMPV/w;
+      grad[12]  = p[10]*dWidth/w;
+      grad[13]  = p[10]*dSigma/w;
+    }
+
+    return g;
+  }
+
+  double ppeFunc(double* x, double* p)
+  {
+    setPPEParameters(p);
+    return evalPPE(x[0], p);
+  }
+  
+  //Functional fit for pedestal plus landgauss MIP peak
+  double mipFunc(double* x, double* p)
+  {
+    setMIPParameters(p);
+    return evalMIP(x[0], p);
+  }
+
+  //Model at nPoints positions (e.g. all bin centres of a fit range) for one parameter vector;
+  //the parameter dependent work is done once per call instead of once per point
+  void eval(const double* x, const int nPoints, const double* p, double* result)
+  {
+    setPPEParameters(p);
+    if(domip_) setMIPParameters(p);
+
+    if(kernel_ != Kernel::Formula && binEdges_.empty())
+    {
+      ppeKernelBatch_(x, nPoints, p, sc.data(), nPeaks_, result);
+      if(domip_) for(int i = 0; i < nPoints; i++) result[i] += evalMIP(x[i], p);
+      return;
+    }
+
+    for(int i = 0; i < nPoints; i++)
+    {
+      result[i] = evalPPE(x[i], p);
+      if(domip_) result[i] += evalMIP(x[i], p);
+    }
+  }
+
+  //Model averaged over the bins [a[i], b[i]] for one parameter vector, whatever the bin edges set
+  void evalBins(const double* a, const double* b, const int nBins, const double* p, double* result)
+  {
+    setPPEParameters(p);
+    if(domip_) setMIPParameters(p);
+
+    for(int i = 0; i < nBins; i++)
+    {
+      result[i] = ppeBinKernel_(a[i]-p[2], b[i]-p[2], p, sc.data(), nPeaks_);
+      if(domip_) result[i] += mip_.integral(a[i]-p[2], b[i]-p[2])/(b[i] - a[i]);
+    }
   }
 
   double operator()(double* x, double* p)
@@ -282,6 +645,24 @@ class PPEFunc
     }
     return returnVal;
   }
+
+#ifdef R__HAS_VECCORE
+  //Entry point for vectorized TF1 evaluation, one parameter update per SIMD vector of points:
+  //  std::function<ROOT::Double_v(const ROOT::Double_v*, const double*)> f = ppe;
+  //  TF1 fit("fit", f, xMin, xMax, 14);
+  ROOT::Double_v operator()(const ROOT::Double_v* x, const double* p)
+  {
+    constexpr int nLanes = vecCore::VectorSize<ROOT::Double_v>();
+    double xLanes[nLanes], result[nLanes];
+    for(int i = 0; i < nLanes; i++) xLanes[i] = vecCore::Get(x[0], i);
+
+    eval(xLanes, nLanes, p, result);
+
+    ROOT::Double_v returnVal;
+    for(int i = 0; i < nLanes; i++) vecCore::Set(returnVal, i, result[i]);
+    return returnVal;
+  }
+#endif
 };
 
 #endif
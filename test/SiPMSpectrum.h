@@ -0,0 +1,36 @@
+#ifndef SiPMSpectrum_h
+#define SiPMSpectrum_h
+
+#include "TH1.h"
+#include "TRandom3.h"
+#include <cmath>
+
+//The SiPM spectrum of one channel as mipFitsSiPM fits it: the normalization of the filled
+//histogram, and synthetic hits for the benchmarks and tests
+
+//Turn counts into counts per unit of x (the bins of a booking can differ in width), keeping the
+//integral; under- and overflow are left alone
+inline void normalizeBinWidth(TH1* h)
+{
+    const double nEvents = h->Integral();
+    for(int j = 0; j < h->GetNbinsX()+1; j++)
+    {
+        const double binWidth = h->GetBinWidth(j);
+        h->SetBinContent(j, h->GetBinContent(j)/binWidth);
+        h->SetBinError(j, h->GetBinError(j)/binWidth);
+    }
+    h->Scale(nEvents/h->Integral());
+}
+
+//One hit: the pedestal, a Poisson number of photo electrons and, in mipFraction of the events, a
+//MIP (Landau(600, 60) above the pedestal)
+inline double sipmHit(TRandom3& rnd, const double pedestal, const double gain, const double meanPE = 0.15, const double mipFraction = 0.1)
+{
+    double x = pedestal + rnd.Gaus(0, 8);
+    const int nPE = rnd.Poisson(meanPE);
+    x += nPE*gain + rnd.Gaus(0, 15*std::sqrt(nPE));
+    if(rnd.Rndm() < mipFraction) x += rnd.Landau(600, 60);
+    return x;
+}
+
+#endif
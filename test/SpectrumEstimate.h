@@ -0,0 +1,305 @@
+#ifndef SpectrumEstimate_h
+#define SpectrumEstimate_h
+
+#include "SPEfunc.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+//Start values for the SiPM spectrum fit read off the spectrum itself
+//
+//The pedestal is the highest bin; its position, width and height come from the parabola through
+//the logarithm of the bins within its half maximum, corrected for the bin width (a Gaussian is a
+//parabola in log).  The PE peak spacing is a lag of large autocorrelation of the log spectrum
+//curvature above the pedestal, resampled to the finest bin width, where the peak comb is a periodic
+//signal; the first of the largest maxima with a peak one lag above the pedestal is refined peak by
+//peak with the same parabolas through the visible peaks.  A visible peak stands above the spectrum
+//half a spacing to either side and is at least as wide as the one before it, so that neither a
+//harmonic of the spacing nor the MIP peak or a fluctuation of its tail passes for a PE peak.  The
+//ratio of the first two PE peak heights gives the mean
+//number of PE through the crosstalk model of PPEFunc at a given crosstalk probability (the default
+//mean if only one peak is visible or the ratio is that of the crosstalk alone), the first peak
+//height the PE amplitude.  The MIP peak is the maximum of the spectrum averaged over one gain
+//beyond the visible PE peaks, if it rises above the valley before it.
+//
+//The contents are those of the fit, i.e. densities scaled to the number of entries (counts for a
+//uniform binning, as the likelihood of the fit takes them), and the heights are model amplitudes.
+
+struct SpectrumEstimate
+{
+  //pedestal and PE peaks found, the rest is only valid then
+  bool valid;
+  double pedestal, pedWidth, pedAmplitude;
+  double gain, peWidth, peAmplitude, meanPE;
+  //number of PE peaks above the pedestal used for the gain
+  int nPeaks;
+  //MIP peak above the pedestal, if mipFound
+  bool mipFound;
+  double mipMPV;
+};
+
+namespace SpectrumEstimateDetail
+{
+  //Gaussian through the logarithm of the contents of bins i-k..i+k, the least squares parabola
+  //weighted by the contents (the inverse variance of the logarithm of a count): false if bin i or a
+  //neighbour is empty or the parabola does not open downwards
+  inline bool logParabola(const std::vector<double>& edges, const std::vector<double>& y, const int i, double& mean, double& sigma, double& height, const int k = 1)
+  {
+    const int nBins = y.size();
+    if(i < 1 || i + 1 >= nBins || !(y[i - 1] > 0 && y[i] > 0 && y[i + 1] > 0)) return false;
+    //sums of w x^n and w x^n ln y about the centre of bin i
+    const double x0 = 0.5*(edges[i] + edges[i + 1]);
+    double sw[5] = {0, 0, 0, 0, 0}, sl[3] = {0, 0, 0};
+    for(int j = std::max(0, i - k); j <= std::min(nBins - 1, i + k); j++)
+    {
+      if(!(y[j] > 0)) continue;
+      const double x = 0.5*(edges[j] + edges[j + 1]) - x0;
+      const double l = std::log(y[j]);
+      double wx = y[j];
+      for(int n = 0; n < 5; n++)
+      {
+        sw[n] += wx;
+        if(n < 3) sl[n] += wx*l;
+        wx *= x;
+      }
+    }
+    //normal equations of ln y = c + b x + a x^2, by Cramer's rule
+    auto det = [](const double m[3][3])
+    {
+      return m[0][0]*(m[1][1]*m[2][2] - m[1][2]*m[2][1]) - m[0][1]*(m[1][0]*m[2][2] - m[1][2]*m[2][0]) + m[0][2]*(m[1][0]*m[2][1] - m[1][1]*m[2][0]);
+    };
+    double m[3][3] = {{sw[0], sw[1], sw[2]}, {sw[1], sw[2], sw[3]}, {sw[2], sw[3], sw[4]}};
+    const double d = det(m);
+    if(!(d != 0)) return false;
+    double coef[3];
+    for(int col = 0; col < 3; col++)
+    {
+      double mc[3][3];
+      for(int r = 0; r < 3; r++) for(int c = 0; c < 3; c++) mc[r][c] = c == col ? sl[r] : m[r][c];
+      coef[col] = det(mc)/d;
+    }
+    const double c = coef[0], b = coef[1], a = coef[2];
+    if(!(a < 0)) return false;
+    mean = x0 - b/(2*a);
+    const double sigma2 = -1/(2*a);
+    height = std::exp(c - b*b/(4*a));
+
+    //the bin averages are the Gaussian convolved with the bin, sigma^2 + w^2/12
+    const double w = edges[i + 1] - edges[i];
+    const double corrected = sigma2 - w*w/12;
+    sigma = std::sqrt(corrected > 0.25*sigma2 ? corrected : 0.25*sigma2);
+    height *= std::sqrt(sigma2)/sigma;
+    return true;
+  }
+
+  //Half the number of bins between the half maxima around bin i, at least 1
+  inline int halfWidth(const std::vector<double>& y, const int i)
+  {
+    int low = i, high = i;
+    while(low > 0 && y[low - 1] > 0.5*y[i]) low--;
+    while(high + 1 < static_cast<int>(y.size()) && y[high + 1] > 0.5*y[i]) high++;
+    return std::max(1, (high - low + 1)/2);
+  }
+
+  //Mean content over [xLow, xHigh]
+  inline double average(const std::vector<double>& edges, const std::vector<double>& y, const double xLow, const double xHigh)
+  {
+    double sum = 0, width = 0;
+    for(unsigned int i = 0; i < y.size(); i++)
+    {
+      const double overlap = std::min(edges[i + 1], xHigh) - std::max(edges[i], xLow);
+      if(overlap <= 0) continue;
+      sum += y[i]*overlap;
+      width += overlap;
+    }
+    return width > 0 ? sum/width : 0;
+  }
+
+  //Probabilities sc[k] of k fired cells for mean primaries, as PPEFunc::computeCoefficients
+  inline void firedCells(const double mean, const double ctProb, const int n, const int kMax, std::vector<double>& sc)
+  {
+    std::vector<double> cp(kMax + 1, 0.0);
+    for(int k = 1; k <= kMax; k++) cp[k] = crosstalkCombinatorics(k, n)*std::pow(ctProb, k - 1)*std::pow(1 - ctProb, k*n - (k - 1));
+    sc.assign(kMax + 1, 0.0);
+    sc[0] = std::exp(-mean);
+    for(int k = 1; k <= kMax; k++)
+    {
+      double sum = 0;
+      for(int j = 1; j <= k; j++) sum += j*cp[j]*sc[k - j];
+      sc[k] = mean/k*sum;
+    }
+  }
+
+  //Bin of the largest content with its centre in [xLow, xHigh], -1 if none
+  inline int maxBin(const std::vector<double>& edges, const std::vector<double>& y, const double xLow, const double xHigh)
+  {
+    int best = -1;
+    for(unsigned int i = 0; i < y.size(); i++)
+    {
+      const double x = 0.5*(edges[i] + edges[i + 1]);
+      if(x < xLow || x > xHigh) continue;
+      if(best < 0 || y[i] > y[best]) best = i;
+    }
+    return best;
+  }
+}
+
+//Estimate from the contents y of the bins [edges[i], edges[i + 1]], for crosstalk probability
+//ctProb between n neighbours
+inline SpectrumEstimate estimateSpectrum(const std::vector<double>& edges, const std::vector<double>& y, const double ctProb = 0.05, const int n = 4,
+                                         const double defaultMeanPE = 0.15)
+{
+  using namespace SpectrumEstimateDetail;
+  SpectrumEstimate e;
+  e.valid = false;
+  e.mipFound = false;
+  e.nPeaks = 0;
+  e.pedestal = e.pedWidth = e.pedAmplitude = e.gain = e.peWidth = e.peAmplitude = e.meanPE = e.mipMPV = 0;
+  const int nBins = y.size();
+  if(nBins < 8 || static_cast<int>(edges.size()) != nBins + 1) return e;
+
+  //pedestal
+  const int iPed = std::max_element(y.begin(), y.end()) - y.begin();
+  if(!logParabola(edges, y, iPed, e.pedestal, e.pedWidth, e.pedAmplitude, halfWidth(y, iPed))) return e;
+
+  //log spectrum above the pedestal on a uniform grid of the finest bin width, cut at 30 counts (the
+  //logarithm of fewer fluctuates by more than the PE peaks curve it, e.g. in the tail of a MIP
+  //peak), or at 5 % of the pedestal in a short run, and at least at 1e-4 of it
+  double step = edges[1] - edges[0];
+  for(int i = 1; i < nBins; i++) step = std::min(step, edges[i + 1] - edges[i]);
+  const double floor = std::max(1e-4*e.pedAmplitude, std::min(30.0, 0.05*e.pedAmplitude));
+  std::vector<double> l;
+  for(int i = iPed; i < nBins; i++)
+  {
+    const int nSteps = std::max(1, static_cast<int>(std::lround((edges[i + 1] - edges[i])/step)));
+    l.insert(l.end(), nSteps, std::log(std::max(y[i], floor)));
+  }
+
+  //curvature over 1.5 pedestal widths (the PE peaks are wider), whose autocorrelation peaks at the
+  //PE spacing; the peaks are at least 4 pedestal widths apart
+  const int h = std::max(2, static_cast<int>(std::lround(1.5*e.pedWidth/step)));
+  const int nGrid = l.size();
+  std::vector<double> c;
+  for(int i = h; i + h < nGrid; i++) c.push_back(2*l[i] - l[i - h] - l[i + h]);
+  const int nC = c.size();
+  const int minLag = std::max(2*h, static_cast<int>(std::ceil(4*e.pedWidth/step)));
+  const int maxLag = nC/2;
+  if(maxLag <= minLag + 1) return e;
+  std::vector<double> r(maxLag + 2, 0.0);
+  for(int lag = minLag - 1; lag <= maxLag; lag++)
+  {
+    double sum = 0;
+    for(int i = 0; i + lag < nC; i++) sum += c[i]*c[i + lag];
+    r[lag] = sum/(nC - lag);
+  }
+
+  //refine a spacing with the visible peaks, the least squares gain through the pedestal, which
+  //places the next peak and the valleys around it
+  std::vector<double> height;
+  auto refine = [&](const double gain)
+  {
+    height.clear();
+    double sumMX = 0, sumMM = 0, spacing = gain, width = e.pedWidth;
+    for(int m = 1; m <= 8; m++)
+    {
+      const double expected = e.pedestal + m*spacing;
+      const int i = maxBin(edges, y, expected - 0.3*spacing, expected + 0.3*spacing);
+      if(i < 0) break;
+      const int k = std::max(halfWidth(y, i), static_cast<int>(std::lround(width/(edges[i + 1] - edges[i]))));
+      double mean, sigma, amplitude;
+      if(!logParabola(edges, y, i, mean, sigma, amplitude, k) || std::fabs(mean - expected) > 0.3*spacing || sigma < 0.7*width) break;
+      const double next = (sumMX + m*(mean - e.pedestal))/(sumMM + m*m);
+      if(!(average(edges, y, mean - 0.6*next, mean - 0.4*next) < 0.5*amplitude && average(edges, y, mean + 0.4*next, mean + 0.6*next) < 0.5*amplitude)) break;
+      if(m == 1)
+      {
+        //nothing beyond the pedestal tail stands above the first peak, else a MIP peak was taken for it
+        const int iHigher = maxBin(edges, y, e.pedestal + 5*e.pedWidth, mean - 0.4*next);
+        if(iHigher >= 0 && y[iHigher] > amplitude) break;
+        e.peWidth = sigma;
+      }
+      height.push_back(amplitude);
+      sumMX += m*(mean - e.pedestal);
+      sumMM += m*m;
+      spacing = next;
+      width = sigma;
+    }
+    e.nPeaks = height.size();
+    if(e.nPeaks > 0) e.gain = spacing;
+  };
+
+  //the local maxima of the autocorrelation in decreasing order, the first with a peak where it
+  //expects one; the second harmonic can win where the peaks are few, the fundamental is tried first
+  //if it is close
+  std::vector<std::pair<double, int>> candidates;
+  for(int lag = minLag; lag < maxLag; lag++)
+  {
+    if(r[lag] > 0 && r[lag] >= r[lag - 1] && r[lag] >= r[lag + 1]) candidates.push_back(std::make_pair(-r[lag], lag));
+  }
+  std::sort(candidates.begin(), candidates.end());
+  for(unsigned int iCandidate = 0; iCandidate < candidates.size() && iCandidate < 5 && e.nPeaks == 0; iCandidate++)
+  {
+    const int lag = candidates[iCandidate].second;
+    const int half = lag/2;
+    for(const int best : {half, lag})
+    {
+      if(e.nPeaks > 0 || (best == half && !(half > minLag && r[half] > 0.7*r[lag]))) continue;
+      double gain = best*step;
+      const double denom = r[best - 1] - 2*r[best] + r[best + 1];
+      if(denom < 0) gain += 0.5*step*(r[best - 1] - r[best + 1])/denom;
+      refine(gain);
+    }
+  }
+  if(e.nPeaks == 0) return e;
+
+  //peak m above the pedestal has the amplitude sc[m+1] p5; sc[3]/sc[2] rises with the mean, from
+  //the crosstalk alone at small means, where the ratio says nothing about the mean
+  std::vector<double> sc;
+  e.meanPE = defaultMeanPE;
+  double lo = 1e-3, hi = 5;
+  const double ratio = e.nPeaks > 1 ? height[1]/height[0] : 0;
+  firedCells(lo, ctProb, n, 3, sc);
+  const double ratioLow = sc[3]/sc[2];
+  firedCells(hi, ctProb, n, 3, sc);
+  if(ratio > ratioLow && ratio < sc[3]/sc[2])
+  {
+    for(int i = 0; i < 50; i++)
+    {
+      e.meanPE = 0.5*(lo + hi);
+      firedCells(e.meanPE, ctProb, n, 3, sc);
+      (sc[3]/sc[2] < ratio ? lo : hi) = e.meanPE;
+    }
+  }
+  firedCells(e.meanPE, ctProb, n, 3, sc);
+  e.peAmplitude = height[0]/sc[2];
+  e.valid = true;
+
+  //MIP peak in the spectrum averaged over one gain, from one gain beyond the last visible PE peak
+  const double xStart = e.pedestal + (e.nPeaks + 1)*e.gain;
+  std::vector<double> xs, smooth;
+  for(int i = 0; i < nBins; i++)
+  {
+    const double x = 0.5*(edges[i] + edges[i + 1]);
+    if(x < xStart) continue;
+    double sum = 0, width = 0;
+    for(int j = i; j < nBins && edges[j] < edges[i] + e.gain; j++)
+    {
+      sum += y[j]*(edges[j + 1] - edges[j]);
+      width += edges[j + 1] - edges[j];
+    }
+    xs.push_back(x + 0.5*(width - (edges[i + 1] - edges[i])));
+    smooth.push_back(sum/width);
+  }
+  if(smooth.size() > 2)
+  {
+    const int iMIP = std::max_element(smooth.begin(), smooth.end()) - smooth.begin();
+    const double valley = *std::min_element(smooth.begin(), smooth.begin() + iMIP + 1);
+    if(smooth[iMIP] > 1.2*valley)
+    {
+      e.mipFound = true;
+      e.mipMPV = xs[iMIP] - e.pedestal;
+    }
+  }
+  return e;
+}
+
+#endif